@@ -1,592 +1,609 @@
-// Source: https://www.geeksforgeeks.org/sieve-of-eratosthenes/
-// C++ program to print all primes smaller than or equal to
-// n using Sieve of Eratosthenes
-
-// Improved by Dan Strano of Unitary Fund, 2024.
-// We can think of trial division as exact inverse of
-// Sieve of Eratosthenes, with log space and log time.
-// The modular division part is a costly atomic operation.
-// It need only be carried out up the square root of the
-// number under trial. Multiples of 2, 3, 5, 7, and 11 can
-// be entirely skipped in loop enumeration.
-
-#include <cmath>
-#include <cstddef>
-#include <cstdint>
+// Python bindings for the Sieve of Eratosthenes engines.
+// (See include/eratosthenes.hpp for the sieves themselves.)
+
+#include "eratosthenes.hpp"
+#include "prime_table.hpp"
+#include "prime_count.hpp"
+#include "primality.hpp"
+#include "prime_reduce.hpp"
+#include "prime_pattern.hpp"
+#include "partition.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
-#include <boost/multiprecision/cpp_int.hpp>
-
+#include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
-namespace qimcifa {
+namespace py = pybind11;
+
+namespace pybind11 {
+namespace detail {
+// Python ints convert straight to and from BigInteger: as a native word
+// when they fit in one, or else as their little-endian bytes, but never
+// through decimal strings.
+template <> struct type_caster<qimcifa::BigInteger> {
+public:
+#if defined(PYBIND11_VERSION_HEX) && (PYBIND11_VERSION_HEX >= 0x02090000)
+    PYBIND11_TYPE_CASTER(qimcifa::BigInteger, const_name("int"));
+#else
+    PYBIND11_TYPE_CASTER(qimcifa::BigInteger, _("int"));
+#endif
+
+    bool load(handle src, bool)
+    {
+        if (!src || !PyLong_Check(src.ptr())) {
+            return false;
+        }
+
+        int overflow = 0;
+        const long long n = PyLong_AsLongLongAndOverflow(src.ptr(), &overflow);
+        if (!overflow) {
+            if ((n == -1) && PyErr_Occurred()) {
+                PyErr_Clear();
+                return false;
+            }
+            value = n;
+            return true;
+        }
 
-typedef boost::multiprecision::cpp_int BigInteger;
+        const object magnitude = reinterpret_steal<object>(PyNumber_Absolute(src.ptr()));
+        if (!magnitude) {
+            PyErr_Clear();
+            return false;
+        }
+        const size_t byteCount = (magnitude.attr("bit_length")().cast<size_t>() + 7U) >> 3U;
+        const std::string digits = magnitude.attr("to_bytes")(byteCount, "little").cast<std::string>();
+        const unsigned char* begin = reinterpret_cast<const unsigned char*>(digits.data());
+        boost::multiprecision::import_bits(value, begin, begin + digits.size(), 8U, false);
+        if (overflow < 0) {
+            value = -value;
+        }
 
-inline BigInteger sqrt(const BigInteger& toTest)
-{
-    // Otherwise, find b = sqrt(b^2).
-    BigInteger start = 1U, end = toTest >> 1U, ans = 0U;
-    do {
-        const BigInteger mid = (start + end) >> 1U;
+        return true;
+    }
 
-        // If toTest is a perfect square
-        const BigInteger sqr = mid * mid;
-        if (sqr == toTest) {
-            return mid;
+    static handle cast(const qimcifa::BigInteger& src, return_value_policy, handle)
+    {
+        if ((src >= 0) && (src <= std::numeric_limits<unsigned long long>::max())) {
+            return PyLong_FromUnsignedLongLong((unsigned long long)src);
         }
 
-        if (sqr < toTest) {
-            // Since we need floor, we update answer when mid*mid is smaller than p, and move closer to sqrt(p).
-            start = mid + 1U;
-            ans = mid;
-        } else {
-            // If mid*mid is greater than p
-            end = mid - 1U;
+        std::vector<unsigned char> digits;
+        boost::multiprecision::export_bits(qimcifa::BigInteger(boost::multiprecision::abs(src)), std::back_inserter(digits), 8U, false);
+        object n = reinterpret_borrow<object>((PyObject*)&PyLong_Type)
+                       .attr("from_bytes")(bytes(reinterpret_cast<const char*>(digits.data()), digits.size()), "little");
+        if (src < 0) {
+            n = reinterpret_steal<object>(PyNumber_Negative(n.ptr()));
         }
-    } while (start <= end);
 
-    return ans;
-}
+        return n.release();
+    }
+};
+} // namespace detail
+} // namespace pybind11
 
-// We are multiplying out the first distinct primes, below.
+namespace qimcifa {
 
-// Make this NOT a multiple of 2.
-inline BigInteger forward2(const size_t& p) { return (p << 1U) | 1U; }
+// Does n fit a native word? (Negative values are left to BigInteger,
+// which sees no primes below 2.)
+inline bool IsWord(const BigInteger& n) { return (n >= 0) && (n <= std::numeric_limits<uint64_t>::max()); }
 
-inline size_t backward2(const BigInteger& p) { return (size_t)(p >> 1U); }
+// A segmented sieve up to n runs over the window [0, n + 1), so it goes
+// natively while n + 1 still fits a word.
+inline bool IsNative(const BigInteger& n) { return IsWord(n) && (n < std::numeric_limits<uint64_t>::max()); }
 
-// Make this NOT a multiple of 2 or 3.
-inline BigInteger forward3(const size_t& p) { return (p << 1U) + (~(~p | 1U)) - 1U; }
+// A window [lo, hi) goes natively if both of its bounds fit, as the
+// cast of either bound to uint64_t would otherwise truncate it.
+inline bool IsNative(const BigInteger& lo, const BigInteger& hi) { return IsWord(lo) && IsWord(hi); }
 
-inline size_t backward3(const BigInteger& n) { return (size_t)((~(~n | 1U)) / 3U) + 1U; }
+// The plain sieves square the first prime past sqrt(n), and cross off
+// up to 4 * p past n, so they go natively only well short of 2^64.
+// (Their bit set would be far too large to allocate, past this, anyway.)
+inline bool IsPlainNative(const BigInteger& n) { return (n >= 0) && (n < (BigInteger(1U) << 62U)); }
 
-constexpr unsigned char wheel5[8U] = { 1U, 7U, 11U, 13U, 17U, 19U, 23U, 29U };
+// Releases the GIL for a call into the engines, and starts a new run for
+// _last_run_stats(), (as a call guard, or within WithoutGIL()).
+struct EngineCall {
+    py::gil_scoped_release release;
 
-// Make this NOT a multiple of 2, 3, or 5.
-BigInteger forward5(const size_t& p) { return wheel5[p % 8U] + (p / 8U) * 30U; }
+    EngineCall() { ResetSieveStats(); }
+};
 
-size_t backward5(const BigInteger &n) {
-    return std::distance(wheel5, std::lower_bound(wheel5, wheel5 + 8U, (size_t)(n % 30U))) + 8U * (size_t)(n / 30U) + 1U;
+// Runs fn() without the GIL, so that other Python threads carry on
+// meanwhile. (fn() must not touch any Python object.)
+template <typename Fn> auto WithoutGIL(Fn fn) -> decltype(fn()) {
+    EngineCall call;
+    return fn();
 }
 
-constexpr unsigned char wheel7[48U] = {
-    1U, 11U, 13U, 17U, 19U, 23U, 29U, 31U, 37U, 41U, 43U, 47U, 53U, 59U, 61U, 67U, 71U, 73U, 79U, 83U, 89U,
-    97U, 101U, 103U, 107U, 109U, 113U, 121U, 127U, 131U, 137U, 139U, 143U, 149U, 151U, 157U, 163U, 167U,
-    169U, 173U, 179U, 181U, 187U, 191U, 193U, 197U, 199U, 209U
-};
+// Runs the next step of an iterator without the GIL, as more of the run
+// that created it, (so that its stats add up over every step).
+template <typename Fn> auto ResumeWithoutGIL(Fn fn) -> decltype(fn()) {
+    py::gil_scoped_release release;
+    return fn();
+}
 
-// Make this NOT a multiple of 2, 3, 5, or 7.
-BigInteger forward7(const size_t& p) { return wheel7[p % 48U] + (p / 48U) * 210U; }
-
-size_t backward7(const BigInteger& n) {
-    return std::distance(wheel7, std::lower_bound(wheel7, wheel7 + 48U, (size_t)(n % 210U))) + 48U * (size_t)(n / 210U) + 1U;
-}
-
-constexpr unsigned short wheel11[480U] = {
-    1U,    13U,   17U,   19U,   23U,   29U,   31U,   37U,   41U,   43U,   47U,   53U,   59U,   61U,   67U,   71U,   73U,   79U,   83U,   89U,   97U,   101U,  103U,  107U,
-    109U,  113U,  127U,  131U,  137U,  139U,  149U,  151U,  157U,  163U,  167U,  169U,  173U,  179U,  181U,  191U,  193U,  197U,  199U,  211U,  221U,  223U,  227U,  229U,
-    233U,  239U,  241U,  247U,  251U,  257U,  263U,  269U,  271U,  277U,  281U,  283U,  289U,  293U,  299U,  307U,  311U,  313U,  317U,  323U,  331U,  337U,  347U,  349U,
-    353U,  359U,  361U,  367U,  373U,  377U,  379U,  383U,  389U,  391U,  397U,  401U,  403U,  409U,  419U,  421U,  431U,  433U,  437U,  439U,  443U,  449U,  457U,  461U,
-    463U,  467U,  479U,  481U,  487U,  491U,  493U,  499U,  503U,  509U,  521U,  523U,  527U,  529U,  533U,  541U,  547U,  551U,  557U,  559U,  563U,  569U,  571U,  577U,
-    587U,  589U,  593U,  599U,  601U,  607U,  611U,  613U,  617U,  619U,  629U,  631U,  641U,  643U,  647U,  653U,  659U,  661U,  667U,  673U,  677U,  683U,  689U,  691U,
-    697U,  701U,  703U,  709U,  713U,  719U,  727U,  731U,  733U,  739U,  743U,  751U,  757U,  761U,  767U,  769U,  773U,  779U,  787U,  793U,  797U,  799U,  809U,  811U,
-    817U,  821U,  823U,  827U,  829U,  839U,  841U,  851U,  853U,  857U,  859U,  863U,  871U,  877U,  881U,  883U,  887U,  893U,  899U,  901U,  907U,  911U,  919U,  923U,
-    929U,  937U,  941U,  943U,  947U,  949U,  953U,  961U,  967U,  971U,  977U,  983U,  989U,  991U,  997U,  1003U, 1007U, 1009U, 1013U, 1019U, 1021U, 1027U, 1031U, 1033U,
-    1037U, 1039U, 1049U, 1051U, 1061U, 1063U, 1069U, 1073U, 1079U, 1081U, 1087U, 1091U, 1093U, 1097U, 1103U, 1109U, 1117U, 1121U, 1123U, 1129U, 1139U, 1147U, 1151U, 1153U,
-    1157U, 1159U, 1163U, 1171U, 1181U, 1187U, 1189U, 1193U, 1201U, 1207U, 1213U, 1217U, 1219U, 1223U, 1229U, 1231U, 1237U, 1241U, 1247U, 1249U, 1259U, 1261U, 1271U, 1273U,
-    1277U, 1279U, 1283U, 1289U, 1291U, 1297U, 1301U, 1303U, 1307U, 1313U, 1319U, 1321U, 1327U, 1333U, 1339U, 1343U, 1349U, 1357U, 1361U, 1363U, 1367U, 1369U, 1373U, 1381U,
-    1387U, 1391U, 1399U, 1403U, 1409U, 1411U, 1417U, 1423U, 1427U, 1429U, 1433U, 1439U, 1447U, 1451U, 1453U, 1457U, 1459U, 1469U, 1471U, 1481U, 1483U, 1487U, 1489U, 1493U,
-    1499U, 1501U, 1511U, 1513U, 1517U, 1523U, 1531U, 1537U, 1541U, 1543U, 1549U, 1553U, 1559U, 1567U, 1571U, 1577U, 1579U, 1583U, 1591U, 1597U, 1601U, 1607U, 1609U, 1613U,
-    1619U, 1621U, 1627U, 1633U, 1637U, 1643U, 1649U, 1651U, 1657U, 1663U, 1667U, 1669U, 1679U, 1681U, 1691U, 1693U, 1697U, 1699U, 1703U, 1709U, 1711U, 1717U, 1721U, 1723U,
-    1733U, 1739U, 1741U, 1747U, 1751U, 1753U, 1759U, 1763U, 1769U, 1777U, 1781U, 1783U, 1787U, 1789U, 1801U, 1807U, 1811U, 1817U, 1819U, 1823U, 1829U, 1831U, 1843U, 1847U,
-    1849U, 1853U, 1861U, 1867U, 1871U, 1873U, 1877U, 1879U, 1889U, 1891U, 1901U, 1907U, 1909U, 1913U, 1919U, 1921U, 1927U, 1931U, 1933U, 1937U, 1943U, 1949U, 1951U, 1957U,
-    1961U, 1963U, 1973U, 1979U, 1987U, 1993U, 1997U, 1999U, 2003U, 2011U, 2017U, 2021U, 2027U, 2029U, 2033U, 2039U, 2041U, 2047U, 2053U, 2059U, 2063U, 2069U, 2071U, 2077U,
-    2081U, 2083U, 2087U, 2089U, 2099U, 2111U, 2113U, 2117U, 2119U, 2129U, 2131U, 2137U, 2141U, 2143U, 2147U, 2153U, 2159U, 2161U, 2171U, 2173U, 2179U, 2183U, 2197U, 2201U,
-    2203U, 2207U, 2209U, 2213U, 2221U, 2227U, 2231U, 2237U, 2239U, 2243U, 2249U, 2251U, 2257U, 2263U, 2267U, 2269U, 2273U, 2279U, 2281U, 2287U, 2291U, 2293U, 2297U, 2309U};
-
-// Make this NOT a multiple of 2, 3, 5, 7, or 11.
-BigInteger forward11(const size_t &p) { return wheel11[p % 480U] + (p / 480U) * 2310U; }
-
-size_t backward11(const BigInteger &n) {
-    return std::distance(wheel11, std::lower_bound(wheel11, wheel11 + 480U, (size_t)(n % 2310U))) + 480U * (size_t)(n / 2310U) + 1U;
-}
-
-inline size_t GetWheel5and7Increment(unsigned short& wheel5, unsigned long long& wheel7) {
-    constexpr unsigned short wheel5Back = 1U << 9U;
-    constexpr unsigned long long wheel7Back = 1ULL << 55U;
-    unsigned wheelIncrement = 0U;
-    bool is_wheel_multiple = false;
-    do {
-        is_wheel_multiple = (bool)(wheel5 & 1U);
-        wheel5 >>= 1U;
-        if (is_wheel_multiple) {
-            wheel5 |= wheel5Back;
-            ++wheelIncrement;
-            continue;
-        }
+template <typename BigInt> std::vector<std::string> ToStrings(const std::vector<BigInt>& v) {
+    std::vector<std::string> toRet;
+    toRet.reserve(v.size());
+    for (const BigInt& p : v) {
+        toRet.push_back(boost::lexical_cast<std::string>(p));
+    }
 
-        is_wheel_multiple = (bool)(wheel7 & 1U);
-        wheel7 >>= 1U;
-        if (is_wheel_multiple) {
-            wheel7 |= wheel7Back;
-        }
-        ++wheelIncrement;
-    } while (is_wheel_multiple);
+    return toRet;
+}
+
+// Hands the vector's own buffer to NumPy, which frees it with the array.
+py::array_t<uint64_t> ToNumPy(std::vector<uint64_t>&& v) {
+    std::vector<uint64_t>* owned = new std::vector<uint64_t>(std::move(v));
+    py::capsule owner(owned, [](void* o) { delete reinterpret_cast<std::vector<uint64_t>*>(o); });
 
-    return (size_t)wheelIncrement;
+    return py::array_t<uint64_t>(owned->size(), owned->data(), owner);
 }
 
-std::vector<BigInteger> SieveOfEratosthenes(const BigInteger& n)
-{
-    std::vector<BigInteger> knownPrimes = { 2U, 3U, 5U, 7U };
-    if (n < 2U) {
-        return std::vector<BigInteger>();
+// Bounds past IsNative() might still have a uint64_t result.
+py::array_t<uint64_t> ToNumPy(const std::vector<BigInteger>& v) {
+    if (!v.empty() && (v.back() > std::numeric_limits<uint64_t>::max())) {
+        throw std::overflow_error("These primes do not fit in uint64; use the list output instead.");
     }
-
-    if (n < (knownPrimes.back() + 2U)) {
-        const auto highestPrimeIt = std::upper_bound(knownPrimes.begin(), knownPrimes.end(), n);
-        return std::vector<BigInteger>(knownPrimes.begin(), highestPrimeIt);
+    std::vector<uint64_t> toRet;
+    toRet.reserve(v.size());
+    for (const BigInteger& p : v) {
+        toRet.push_back((uint64_t)p);
     }
 
-    knownPrimes.reserve(std::expint(log((double)n)) - std::expint(log(2)));
-
-    // We are excluding multiples of the first few
-    // small primes from outset. For multiples of
-    // 2, 3, and 5 this reduces complexity to 4/15.
-    const size_t cardinality = backward5(n);
-
-    // Create a boolean array "prime[0..cardinality]"
-    // and initialize all entries it as true. Rather,
-    // reverse the true/false meaning, so we can use
-    // default initialization. A value in notPrime[i]
-    // will finally be false only if i is a prime.
-    std::unique_ptr<bool[]> uNotPrime(new bool[cardinality + 1U]());
-    bool* notPrime = uNotPrime.get();
-
-    // Get the remaining prime numbers.
-    // These wheel initializations are simply correct and optimal.
-    // The integral form is rather a distinguishable bit set form.
-    unsigned short wheel5 = 129U;
-    unsigned long long wheel7 = 9009416540524545ULL;
-    size_t o = 1U;
-    for (;;) {
-        o += GetWheel5and7Increment(wheel5, wheel7);
-
-        const BigInteger p = forward3(o);
-        if ((p * p) > n) {
-            break;
-        }
+    return ToNumPy(std::move(toRet));
+}
 
-        if (notPrime[backward5(p)]) {
-            continue;
-        }
+std::vector<std::string> _SieveOfEratosthenes(const std::string& n) {
+    const BigInteger bn(n);
+    if (IsPlainNative(bn)) {
+        return ToStrings(SieveOfEratosthenes((uint64_t)bn));
+    }
 
-        knownPrimes.push_back(p);
-
-        // We are skipping multiples of 2, 3, and 5
-        // for space complexity, for 4/15 the bits.
-        // More are skipped by the wheel for time.
-        const BigInteger p2 = p << 1U;
-        const BigInteger p4 = p << 2U;
-        BigInteger i = p * p;
-
-        // "p" already definitely not a multiple of 3.
-        // Its remainder when divided by 3 can be 1 or 2.
-        // If it is 2, we can do a "half iteration" of the
-        // loop that would handle remainder of 1, and then
-        // we can proceed with the 1 remainder loop.
-        // This saves 2/3 of updates (or modulo).
-        if ((p % 3U) == 2U) {
-            notPrime[backward5(i)] = true;
-            i += p2;
-            if (i > n) {
-                continue;
-            }
-        }
+    return ToStrings(SieveOfEratosthenes(bn));
+}
 
-        for (;;) {
-            if (i % 5U) {
-                notPrime[backward5(i)] = true;
-            }
-            i += p4;
-            if (i > n) {
-                break;
-            }
+std::string _CountPrimesTo(const std::string& n) {
+    const BigInteger bn(n);
+    if (IsPlainNative(bn)) {
+        return boost::lexical_cast<std::string>(CountPrimesTo((uint64_t)bn));
+    }
 
-            if (i % 5U) {
-                notPrime[backward5(i)] = true;
-            }
-            i += p2;
-            if (i > n) {
-                break;
-            }
-        }
+    return boost::lexical_cast<std::string>(CountPrimesTo(bn));
+}
+
+std::vector<std::string> _SegmentedSieveOfEratosthenes(const std::string& n, size_t segmentBytes, unsigned threads) {
+    const BigInteger bn(n);
+    if (IsNative(bn)) {
+        return ToStrings(SegmentedSieveOfEratosthenes((uint64_t)bn, segmentBytes, threads));
     }
 
-    for (;;) {
-        const BigInteger p = forward3(o);
-        if (p > n) {
-            break;
-        }
+    return ToStrings(SegmentedSieveOfEratosthenes(bn, segmentBytes, threads));
+}
 
-        o += GetWheel5and7Increment(wheel5, wheel7);
+std::string _SegmentedCountPrimesTo(const std::string& n, size_t segmentBytes, unsigned threads) {
+    const BigInteger bn(n);
+    if (IsNative(bn)) {
+        return boost::lexical_cast<std::string>(SegmentedCountPrimesTo((uint64_t)bn, segmentBytes, threads));
+    }
 
-        if (notPrime[backward5(p)]) {
-            continue;
-        }
+    return boost::lexical_cast<std::string>(SegmentedCountPrimesTo(bn, segmentBytes, threads));
+}
+
+// Python ints go straight in, and come back out, as ints, often natively.
 
-        knownPrimes.push_back(p);
+py::list _SieveOfEratosthenesInt(const BigInteger& n) {
+    if (IsPlainNative(n)) {
+        return py::cast(WithoutGIL([&] { return SieveOfEratosthenes((uint64_t)n); }));
     }
 
-    return knownPrimes;
+    return py::cast(WithoutGIL([&] { return SieveOfEratosthenes(n); }));
 }
 
-std::vector<BigInteger> SegmentedSieveOfEratosthenes(BigInteger n)
-{
-    // TODO: This should scale to the system.
-    // Assume the L1/L2 cache limit is 2048 KB.
-    // We save half our necessary bytes by
-    // removing multiples of 2.
-    // The simple sieve removes multiples of 2, 3, and 5.
-    // limit = 2048 KB = 2097152 B,
-    // limit = ((((limit * 2) * 3) / 2) * 5) / 4
-    constexpr size_t limit = 7864321ULL;
+// Past primeCountThreshold, counting by LMO beats sieving, (and
+// CountPrimesLMO() takes bounds below 2^62).
+inline bool IsLMO(const BigInteger& n) { return IsPlainNative(n) && (n >= primeCountThreshold); }
 
-    if (!(n & 1U)) {
-        --n;
+py::int_ _CountPrimesToInt(const BigInteger& n) {
+    if (IsLMO(n)) {
+        return py::cast(WithoutGIL([&] { return CountPrimesLMO((uint64_t)n); }));
     }
-    while (((n % 3U) == 0) || ((n % 5U) == 0)) {
-        n -= 2U;
+    if (IsPlainNative(n)) {
+        return py::cast(WithoutGIL([&] { return CountPrimesTo((uint64_t)n); }));
+    }
+
+    return py::cast(WithoutGIL([&] { return CountPrimesTo(n); }));
+}
+
+// Calls fn() with the segmented sieve wheel for a modulus of 30 or 210.
+template <typename Fn> auto WithWheel(const unsigned& wheel, Fn fn) -> decltype(fn(Wheel30())) {
+    if (wheel == 30U) {
+        return fn(Wheel30());
     }
-    if (limit >= n) {
-        return SieveOfEratosthenes(n);
+    if (wheel == 210U) {
+        return fn(Wheel210());
     }
-    std::vector<BigInteger> knownPrimes = SieveOfEratosthenes(limit);
-    knownPrimes.reserve(std::expint(log((double)n)) - std::expint(log(2)));
 
-    // Divide the range in different segments
-    const size_t nCardinality = backward5(n);
-    size_t low = backward5(limit);
-    size_t high = low + limit;
+    throw std::invalid_argument("The wheel must be 30 or 210.");
+}
 
-    // Process one segment at a time till we pass n.
-    while (low < nCardinality)
-    {
-        if (high > nCardinality) {
-           high = nCardinality;
+py::list _SegmentedSieveOfEratosthenesInt(const BigInteger& n, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::list {
+        typedef decltype(w) W;
+        if (IsNative(n)) {
+            return py::cast(WithoutGIL([&] { return SegmentedSieveOfEratosthenes<uint64_t, W>((uint64_t)n, segmentBytes, threads); }));
         }
 
-        const BigInteger fLo = forward5(low);
-        const size_t sqrtIndex = std::distance(
-            knownPrimes.begin(),
-            std::upper_bound(knownPrimes.begin(), knownPrimes.end(), sqrt(forward5(high)) + 1U)
-        );
-
-        const size_t cardinality = high - low;
-        bool notPrime[cardinality + 1U] = { false };
-
-        for (size_t k = 3U; k < sqrtIndex; ++k) {
-            const BigInteger& p = knownPrimes[k];
-            // We are skipping multiples of 2.
-            const BigInteger p2 = p << 1U;
-
-            // Find the minimum number in [low..high] that is
-            // a multiple of prime[i] (divisible by prime[i])
-            // For example, if low is 31 and prime[i] is 3,
-            // we start with 33.
-            BigInteger i = (fLo / p) * p;
-            if (i < fLo) {
-                i += p;
-            }
-            if ((i & 1U) == 0U) {
-                i += p;
-            }
+        return py::cast(WithoutGIL([&] { return SegmentedSieveOfEratosthenes<BigInteger, W>(n, segmentBytes, threads); }));
+    });
+}
 
-            for (;;) {
-                const size_t o = backward5(i) - low;
-                if (o > cardinality) {
-                    break;
-                }
-                if ((i % 3U) && (i % 5U)) {
-                    notPrime[o] = true;
-                }
-                i += p2;
-            }
+py::int_ _SegmentedCountPrimesToInt(const BigInteger& n, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::int_ {
+        typedef decltype(w) W;
+        if (IsLMO(n)) {
+            return py::cast(WithoutGIL([&] { return CountPrimesLMO((uint64_t)n); }));
         }
-
-        // Numbers which are not marked are prime
-        for (size_t o = 1U; o <= cardinality; ++o) {
-            if (!notPrime[o]) {
-                knownPrimes.push_back(forward5(o + low));
-            }
+        if (IsNative(n)) {
+            return py::cast(WithoutGIL([&] { return SegmentedCountPrimesTo<uint64_t, W>((uint64_t)n, segmentBytes, threads); }));
         }
 
-        // Update low and high for next segment
-        low = low + limit;
-        high = low + limit;
-    }
+        return py::cast(WithoutGIL([&] { return SegmentedCountPrimesTo<BigInteger, W>(n, segmentBytes, threads); }));
+    });
+}
 
-    return knownPrimes;
+py::list _SegmentedSieveRange(const BigInteger& lo, const BigInteger& hi, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::list {
+        typedef decltype(w) W;
+        if (IsNative(lo, hi)) {
+            return py::cast(WithoutGIL([&] { return SegmentedSieveRange<uint64_t, W>((uint64_t)lo, (uint64_t)hi, segmentBytes, threads); }));
+        }
+
+        return py::cast(WithoutGIL([&] { return SegmentedSieveRange<BigInteger, W>(lo, hi, segmentBytes, threads); }));
+    });
 }
 
-// Pardon the obvious "copy/pasta."
-// I began to design a single method to switch off between these two,
-// then I realized the execution time overhead of the implementation.
-// (It would compound linearly over the cardinality to check.)
-// It is certainly "cheap" to copy/paste, but that's our only goal.
+py::int_ _SegmentedCountRange(const BigInteger& lo, const BigInteger& hi, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::int_ {
+        typedef decltype(w) W;
+        if (IsNative(lo, hi)) {
+            return py::cast(WithoutGIL([&] { return SegmentedCountRange<uint64_t, W>((uint64_t)lo, (uint64_t)hi, segmentBytes, threads); }));
+        }
 
-BigInteger CountPrimesTo(const BigInteger& n)
-{
-    const BigInteger knownPrimes[4U] = { 2U, 3U, 5U, 7U };
-    if (n < 2U) {
-        return 0U;
-    }
+        return py::cast(WithoutGIL([&] { return SegmentedCountRange<BigInteger, W>(lo, hi, segmentBytes, threads); }));
+    });
+}
 
-    if (n < 11U) {
-        const auto highestPrimeIt = std::upper_bound(knownPrimes, knownPrimes + 4U, n);
-        return std::distance(knownPrimes, highestPrimeIt);
+// Reduces the primes in [lo, hi) by the named op, in word or BigInteger arithmetic.
+template <typename BigInt, typename W>
+py::object ReduceRange(const BigInt& lo, const BigInt& hi, const std::string& op, size_t modulus, size_t segmentBytes, unsigned threads) {
+    if (op == "count") {
+        return py::cast(WithoutGIL([&] { return SegmentedReduceRange<BigInt, W>(lo, hi, PrimeCountOp<BigInt>(), segmentBytes, threads); }));
     }
-
-    // We are excluding multiples of the first few
-    // small primes from outset. For multiples of
-    // 2, 3, and 5 this reduces complexity to 4/15.
-    const size_t cardinality = backward5(n);
-
-    // Create a boolean array "prime[0..cardinality]"
-    // and initialize all entries it as true. Rather,
-    // reverse the true/false meaning, so we can use
-    // default initialization. A value in notPrime[i]
-    // will finally be false only if i is a prime.
-    std::unique_ptr<bool[]> uNotPrime(new bool[cardinality + 1U]());
-    bool* notPrime = uNotPrime.get();
-
-    // Get the remaining prime numbers.
-    // These wheel initializations are simply correct and optimal.
-    // The integral form is rather a distinguishable bit set form.
-    unsigned short wheel5 = 129U;
-    unsigned long long wheel7 = 9009416540524545ULL;
-    size_t o = 1U;
-    BigInteger count = 4U;
-    for (;;) {
-        o += GetWheel5and7Increment(wheel5, wheel7);
-
-        const BigInteger p = forward3(o);
-        if ((p * p) > n) {
-            break;
+    if (op == "sum") {
+        return py::cast(WithoutGIL([&] { return SegmentedReduceRange<BigInt, W>(lo, hi, PrimePowerSumOp<BigInt, 1U>(), segmentBytes, threads); }));
+    }
+    if (op == "sum_squares") {
+        return py::cast(WithoutGIL([&] { return SegmentedReduceRange<BigInt, W>(lo, hi, PrimePowerSumOp<BigInt, 2U>(), segmentBytes, threads); }));
+    }
+    if (op == "residues") {
+        return py::cast(WithoutGIL([&] { return SegmentedReduceRange<BigInt, W>(lo, hi, PrimeResidueCountOp<BigInt>(modulus), segmentBytes, threads); }));
+    }
+    if (op == "max_gap") {
+        const typename PrimeMaxGapOp<BigInt>::Partial part =
+            WithoutGIL([&] { return SegmentedReduceRange<BigInt, W>(lo, hi, PrimeMaxGapOp<BigInt>(), segmentBytes, threads); });
+        if (part.gap == 0U) {
+            return py::make_tuple(0, py::none());
         }
+        return py::make_tuple(py::cast(part.gap), py::cast(part.after));
+    }
 
-        if (notPrime[backward5(p)]) {
-            continue;
-        }
+    throw std::invalid_argument("The op must be count, sum, sum_squares, residues, or max_gap.");
+}
 
-        ++count;
-
-        // We are skipping multiples of 2, 3, and 5
-        // for space complexity, for 4/15 the bits.
-        // More are skipped by the wheel for time.
-        const BigInteger p2 = p << 1U;
-        const BigInteger p4 = p << 2U;
-        BigInteger i = p * p;
-
-        // "p" already definitely not a multiple of 3.
-        // Its remainder when divided by 3 can be 1 or 2.
-        // If it is 2, we can do a "half iteration" of the
-        // loop that would handle remainder of 1, and then
-        // we can proceed with the 1 remainder loop.
-        // This saves 2/3 of updates (or modulo).
-        if ((p % 3U) == 2U) {
-            notPrime[backward5(i)] = true;
-            i += p2;
-            if (i > n) {
-                continue;
-            }
+py::object _SegmentedReduceRange(const BigInteger& lo, const BigInteger& hi, const std::string& op, size_t modulus, size_t segmentBytes,
+    unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::object {
+        typedef decltype(w) W;
+        if (IsNative(lo, hi)) {
+            return ReduceRange<uint64_t, W>((uint64_t)lo, (uint64_t)hi, op, modulus, segmentBytes, threads);
         }
 
-        for (;;) {
-            if (i % 5U) {
-                notPrime[backward5(i)] = true;
-            }
-            i += p4;
-            if (i > n) {
-                break;
-            }
+        return ReduceRange<BigInteger, W>(lo, hi, op, modulus, segmentBytes, threads);
+    });
+}
 
-            if (i % 5U) {
-                notPrime[backward5(i)] = true;
-            }
-            i += p2;
-            if (i > n) {
-                break;
-            }
-        }
-    }
+// (count, first, last, widest gap, the prime before it), with None for any prime there is none of
+template <typename BigInt> py::tuple ToTuple(const RangeSummary<BigInt>& s) {
+    const typename PrimeMaxGapOp<BigInt>::Partial& g = s.gaps;
+    const py::object first = g.isEmpty ? py::none() : py::cast(g.first);
+    const py::object last = g.isEmpty ? py::none() : py::cast(g.last);
+    const py::object after = (g.gap == 0U) ? py::none() : py::cast(g.after);
+
+    return py::make_tuple(py::cast(s.count), first, last, py::cast(g.gap), after);
+}
 
-    for (;;) {
-        const BigInteger p = forward3(o);
-        if (p > n) {
-            break;
+py::list _PartitionRange(const BigInteger& lo, const BigInteger& hi, size_t parts, size_t segmentBytes, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::list {
+        typedef decltype(w) W;
+        if (IsNative(lo, hi)) {
+            return py::cast(PartitionRange<uint64_t, W>((uint64_t)lo, (uint64_t)hi, parts, segmentBytes));
         }
 
-        o += GetWheel5and7Increment(wheel5, wheel7);
+        return py::cast(PartitionRange<BigInteger, W>(lo, hi, parts, segmentBytes));
+    });
+}
 
-        if (notPrime[backward5(p)]) {
-            continue;
+py::tuple _SummarizeRange(const BigInteger& lo, const BigInteger& hi, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::tuple {
+        typedef decltype(w) W;
+        if (IsNative(lo, hi)) {
+            return ToTuple(WithoutGIL([&] { return SummarizeRange<uint64_t, W>((uint64_t)lo, (uint64_t)hi, segmentBytes, threads); }));
         }
 
-        ++count;
-    }
-
-    return count;
+        return ToTuple(WithoutGIL([&] { return SummarizeRange<BigInteger, W>(lo, hi, segmentBytes, threads); }));
+    });
 }
 
-BigInteger SegmentedCountPrimesTo(BigInteger n)
-{
-    // TODO: This should scale to the system.
-    // Assume the L1/L2 cache limit is 2048 KB.
-    // We save half our necessary bytes by
-    // removing multiples of 2.
-    // The simple sieve removes multiples of 2, 3, and 5.
-    // limit = 2048 KB = 2097152 B,
-    // limit = ((((limit * 2) * 3) / 2) * 5) / 4
-    constexpr size_t limit = 7864321ULL;
+// Returns (the primes in [lo, hi), their summary), from one sieve.
+py::tuple _SieveRangeSummary(const BigInteger& lo, const BigInteger& hi, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::tuple {
+        typedef decltype(w) W;
+        if (IsNative(lo, hi)) {
+            const std::vector<uint64_t> primes =
+                WithoutGIL([&] { return SegmentedSieveRange<uint64_t, W>((uint64_t)lo, (uint64_t)hi, segmentBytes, threads); });
+            return py::make_tuple(py::cast(primes), ToTuple(SummarizePrimes(primes)));
+        }
 
-    if (!(n & 1U)) {
-        --n;
-    }
-    while (((n % 3U) == 0) || ((n % 5U) == 0)) {
-        n -= 2U;
-    }
-    if (limit >= n) {
-        return CountPrimesTo(n);
-    }
-    BigInteger sqrtnp1 = (sqrt(n) + 1U) | 1U;
-    while (((sqrtnp1 % 3U) == 0U) || ((sqrtnp1 % 5U) == 0U)) {
-        sqrtnp1 += 2U;
-    }
-    const BigInteger practicalLimit = (sqrtnp1 < limit) ? sqrtnp1 : limit;
-    std::vector<BigInteger> knownPrimes = SieveOfEratosthenes(practicalLimit);
-    if (practicalLimit < sqrtnp1) {
-        knownPrimes.reserve(std::expint(log((double)sqrtnp1)) - std::expint(log(2)));
+        const std::vector<BigInteger> primes = WithoutGIL([&] { return SegmentedSieveRange<BigInteger, W>(lo, hi, segmentBytes, threads); });
+        return py::make_tuple(py::cast(primes), ToTuple(SummarizePrimes(primes)));
+    });
+}
+
+py::array_t<uint64_t> _SieveOfEratosthenesNumPy(const BigInteger& n) {
+    if (IsPlainNative(n)) {
+        return ToNumPy(WithoutGIL([&] { return SieveOfEratosthenes((uint64_t)n); }));
     }
-    size_t count = knownPrimes.size();
 
-    // Divide the range in different segments
-    const size_t nCardinality = backward5(n);
-    size_t low = backward5(practicalLimit);
-    size_t high = low + limit;
+    return ToNumPy(WithoutGIL([&] { return SieveOfEratosthenes(n); }));
+}
 
-    // Process one segment at a time till we pass n.
-    while (low < nCardinality)
-    {
-        if (high > nCardinality) {
-           high = nCardinality;
+py::array_t<uint64_t> _SegmentedSieveOfEratosthenesNumPy(const BigInteger& n, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::array_t<uint64_t> {
+        typedef decltype(w) W;
+        if (IsNative(n)) {
+            return ToNumPy(WithoutGIL([&] { return SegmentedSieveOfEratosthenes<uint64_t, W>((uint64_t)n, segmentBytes, threads); }));
         }
-        const BigInteger fLo = forward5(low);
-        const size_t sqrtIndex = std::distance(
-            knownPrimes.begin(),
-            std::upper_bound(knownPrimes.begin(), knownPrimes.end(), sqrt(forward5(high)) + 1U)
-        );
-
-        const size_t cardinality = high - low;
-        bool notPrime[cardinality + 1U] = { false };
-
-        // Use the primes found by the simple sieve
-        // to find primes in current range
-        for (size_t k = 3U; k < sqrtIndex; ++k) {
-            const BigInteger& p = knownPrimes[k];
-            // We are skipping multiples of 2.
-            const BigInteger p2 = p << 1U;
-
-            // Find the minimum number in [low..high] that is
-            // a multiple of prime[i] (divisible by prime[i])
-            // For example, if low is 31 and prime[i] is 3,
-            // we start with 33.
-            BigInteger i = (fLo / p) * p;
-            if (i < fLo) {
-                i += p;
-            }
-            if ((i & 1U) == 0U) {
-                i += p;
-            }
 
-            for (;;) {
-                const size_t o = backward5(i) - low;
-                if (o > cardinality) {
-                    break;
-                }
-                if ((i % 3U) && (i % 5U)) {
-                    notPrime[o] = true;
-                }
-                i += p2;
-            }
-        }
+        return ToNumPy(WithoutGIL([&] { return SegmentedSieveOfEratosthenes<BigInteger, W>(n, segmentBytes, threads); }));
+    });
+}
 
-        if (knownPrimes.back() >= sqrtnp1) {
-            for (size_t o = 1U; o <= cardinality; ++o) {
-                if (!notPrime[o]) {
-                    ++count;
-                }
-            }
-        } else {
-            for (size_t o = 1U; o <= cardinality; ++o) {
-                if (!notPrime[o]) {
-                    const BigInteger p = forward5(o + low);
-                    if (p <= sqrtnp1) {
-                        knownPrimes.push_back(p);
-                    }
-                    ++count;
-                }
-            }
+py::array_t<uint64_t> _SegmentedSieveRangeNumPy(const BigInteger& lo, const BigInteger& hi, size_t segmentBytes, unsigned threads, unsigned wheel) {
+    return WithWheel(wheel, [&](auto w) -> py::array_t<uint64_t> {
+        typedef decltype(w) W;
+        if (IsNative(lo, hi)) {
+            return ToNumPy(WithoutGIL([&] { return SegmentedSieveRange<uint64_t, W>((uint64_t)lo, (uint64_t)hi, segmentBytes, threads); }));
         }
 
-        // Update low and high for next segment
-        low = low + limit;
-        high = low + limit;
+        return ToNumPy(WithoutGIL([&] { return SegmentedSieveRange<BigInteger, W>(lo, hi, segmentBytes, threads); }));
+    });
+}
+
+// The stats of the last call into the engines, or None, unless built with QIMCIFA_STATS
+py::object _LastRunStats() {
+    if (!isSieveStatsEnabled) {
+        return py::none();
     }
 
-    return count;
+    const SieveStats stats = GetSieveStats();
+    py::dict toRet;
+    toRet["base_primes_seconds"] = stats.basePrimeSeconds;
+    toRet["setup_seconds"] = stats.setupSeconds;
+    toRet["cross_off_seconds"] = stats.crossOffSeconds;
+    toRet["scan_seconds"] = stats.scanSeconds;
+    toRet["phi_seconds"] = stats.phiSeconds;
+    toRet["segments"] = stats.segments;
+    toRet["base_primes"] = stats.basePrimes;
+    toRet["cross_offs"] = stats.crossOffs;
+    toRet["bytes_allocated"] = stats.bytesAllocated;
+
+    return toRet;
 }
 
-std::vector<std::string> _SieveOfEratosthenes(const std::string& n) {
-    std::vector<BigInteger> v = SieveOfEratosthenes(BigInteger(n));
-    std::vector<std::string> toRet;
-    toRet.reserve(v.size());
-    for (const BigInteger& p : v) {
-        toRet.push_back(boost::lexical_cast<std::string>(p));
+// A batch goes natively if every value in it fits, or else all as BigInteger.
+inline bool IsNative(const std::vector<BigInteger>& xs) {
+    return std::all_of(xs.begin(), xs.end(), [](const BigInteger& x) { return IsWord(x); });
+}
+
+// The greatest prime below 2^64, (past which a next prime would not fit)
+constexpr uint64_t maxWordPrime = 18446744073709551557ULL;
+
+// A batch of next primes goes natively if every one of those fits a word.
+inline bool IsNextNative(const std::vector<BigInteger>& xs) {
+    return std::all_of(xs.begin(), xs.end(), [](const BigInteger& x) { return (x >= 0) && (x < maxWordPrime); });
+}
+
+std::vector<uint64_t> ToNative(const std::vector<BigInteger>& xs) {
+    std::vector<uint64_t> toRet;
+    toRet.reserve(xs.size());
+    for (const BigInteger& x : xs) {
+        toRet.push_back((uint64_t)x);
     }
 
     return toRet;
 }
 
-std::string _CountPrimesTo(const std::string& n) {
-    return boost::lexical_cast<std::string>(CountPrimesTo(BigInteger(n)));
+py::list _IsPrimeBatch(const std::vector<BigInteger>& xs, unsigned threads) {
+    const std::vector<unsigned char> isPrime =
+        WithoutGIL([&] { return IsNative(xs) ? IsPrimeBatch(ToNative(xs), threads) : IsPrimeBatch(xs, threads); });
+    py::list toRet;
+    for (const unsigned char& b : isPrime) {
+        toRet.append(py::bool_(b != 0U));
+    }
+
+    return toRet;
 }
 
-std::vector<std::string> _SegmentedSieveOfEratosthenes(const std::string& n) {
-    std::vector<BigInteger> v = SegmentedSieveOfEratosthenes(BigInteger(n));
-    std::vector<std::string> toRet;
-    toRet.reserve(v.size());
-    for (const BigInteger& p : v) {
-        toRet.push_back(boost::lexical_cast<std::string>(p));
+py::list _NextPrimeBatch(const std::vector<BigInteger>& xs, unsigned threads) {
+    if (IsNextNative(xs)) {
+        return py::cast(WithoutGIL([&] { return NextPrimeBatch(ToNative(xs), threads); }));
     }
 
-    return toRet;
+    return py::cast(WithoutGIL([&] { return NextPrimeBatch(xs, threads); }));
 }
 
-std::string _SegmentedCountPrimesTo(const std::string& n) {
-    return boost::lexical_cast<std::string>(SegmentedCountPrimesTo(BigInteger(n)));
+py::list _PrevPrimeBatch(const std::vector<BigInteger>& xs, unsigned threads) {
+    if (IsNative(xs)) {
+        return py::cast(WithoutGIL([&] { return PrevPrimeBatch(ToNative(xs), threads); }));
+    }
+
+    return py::cast(WithoutGIL([&] { return PrevPrimeBatch(xs, threads); }));
 }
+
+// Streams the primes of [lo, hi) to Python one segment at a time.
+class _SegmentedSieveIterator {
+protected:
+    // (These close over whichever engine iterator fits the bounds and wheel.)
+    std::function<bool()> isDone;
+    std::function<py::list()> next;
+
+    template <typename BigInt, typename W> void Reset(const BigInt& lo, const BigInt& hi, size_t segmentBytes) {
+        const std::shared_ptr<SegmentedSieveIterator<BigInt, W>> it =
+            std::make_shared<SegmentedSieveIterator<BigInt, W>>(lo, hi, segmentBytes);
+        isDone = [it]() { return it->IsDone(); };
+        next = [it]() -> py::list { return py::cast(ResumeWithoutGIL([&] { return it->Next(); })); };
+    }
+
+public:
+    _SegmentedSieveIterator(const BigInteger& lo, const BigInteger& hi, size_t segmentBytes, unsigned wheel) {
+        WithWheel(wheel, [&](auto w) {
+            typedef decltype(w) W;
+            if (IsNative(lo, hi)) {
+                Reset<uint64_t, W>((uint64_t)lo, (uint64_t)hi, segmentBytes);
+            } else {
+                Reset<BigInteger, W>(lo, hi, segmentBytes);
+            }
+        });
+    }
+
+    bool IsDone() const { return isDone(); }
+
+    py::list Next() { return next(); }
+};
+
+// Streams the prime gaps, or prime tuples, of [lo, hi) to Python a batch of segments at a time.
+class _PrimePatternIterator {
+protected:
+    std::function<bool()> isDone;
+    std::function<py::list()> next;
+
+    template <typename BigInt, typename W, typename Op>
+    void Reset(const BigInt& lo, const BigInt& hi, const Op& op, size_t segmentBytes, unsigned threads) {
+        const std::shared_ptr<PrimePatternIterator<BigInt, W, Op>> it =
+            std::make_shared<PrimePatternIterator<BigInt, W, Op>>(lo, hi, op, segmentBytes, threads);
+        isDone = [it]() { return it->IsDone(); };
+        next = [it]() -> py::list { return py::cast(ResumeWithoutGIL([&] { return it->Next(); })); };
+    }
+
+public:
+    // Each gap of at least minGap, as (the prime before it, its width)
+    _PrimePatternIterator(const BigInteger& lo, const BigInteger& hi, size_t minGap, size_t segmentBytes, unsigned threads, unsigned wheel) {
+        WithWheel(wheel, [&](auto w) {
+            typedef decltype(w) W;
+            if (IsNative(lo, hi)) {
+                Reset<uint64_t, W>((uint64_t)lo, (uint64_t)hi, PrimeGapScan<uint64_t>(minGap), segmentBytes, threads);
+            } else {
+                Reset<BigInteger, W>(lo, hi, PrimeGapScan<BigInteger>(minGap), segmentBytes, threads);
+            }
+        });
+    }
+
+    // Each p where p + d is prime for every d of "pattern"
+    _PrimePatternIterator(const BigInteger& lo, const BigInteger& hi, const std::vector<size_t>& pattern, size_t segmentBytes, unsigned threads,
+        unsigned wheel) {
+        WithWheel(wheel, [&](auto w) {
+            typedef decltype(w) W;
+            if (IsNative(lo, hi)) {
+                Reset<uint64_t, W>((uint64_t)lo, (uint64_t)hi, PrimeTupleScan<uint64_t>(pattern), segmentBytes, threads);
+            } else {
+                Reset<BigInteger, W>(lo, hi, PrimeTupleScan<BigInteger>(pattern), segmentBytes, threads);
+            }
+        });
+    }
+
+    bool IsDone() const { return isDone(); }
+
+    py::list Next() { return next(); }
+};
 } // namespace qimcifa
 
 using namespace qimcifa;
 
 PYBIND11_MODULE(_eratosthenes, m) {
     m.doc() = "pybind11 plugin to generate prime numbers";
-    m.def("_count", &_CountPrimesTo, "Counts the prime numbers between 1 and the value of its argument");
-    m.def("_segmented_count", &_SegmentedCountPrimesTo, "Counts the primes in capped space complexity");
-    m.def("_sieve", &_SieveOfEratosthenes, "Returns all primes up to the value of its argument (using Sieve of Eratosthenes)");
-    m.def("_segmented_sieve", &_SegmentedSieveOfEratosthenes, "Returns the primes in capped space complexity");
+    // (The int overloads come first, so that pybind11 tries them first.)
+    m.def("_count", &_CountPrimesToInt, "Counts the prime numbers between 1 and the value of its argument");
+    m.def("_count", &_CountPrimesTo, py::call_guard<EngineCall>(), "Counts the prime numbers between 1 and the value of its argument");
+    m.def("_segmented_count", &_SegmentedCountPrimesToInt, "Counts the primes in capped space complexity, over any number of threads (0 for all)");
+    m.def("_segmented_count", &_SegmentedCountPrimesTo, py::call_guard<EngineCall>(), "Counts the primes in capped space complexity, over any number of threads (0 for all)");
+    m.def("_sieve", &_SieveOfEratosthenesInt, "Returns all primes up to the value of its argument (using Sieve of Eratosthenes)");
+    m.def("_sieve", &_SieveOfEratosthenes, py::call_guard<EngineCall>(), "Returns all primes up to the value of its argument (using Sieve of Eratosthenes)");
+    m.def("_segmented_sieve", &_SegmentedSieveOfEratosthenesInt, "Returns the primes in capped space complexity, over any number of threads (0 for all)");
+    m.def("_segmented_sieve", &_SegmentedSieveOfEratosthenes, py::call_guard<EngineCall>(), "Returns the primes in capped space complexity, over any number of threads (0 for all)");
+    m.def("_sieve_range", &_SegmentedSieveRange, "Returns the primes in [lo, hi), sieving only that window and the base primes up to sqrt(hi)");
+    m.def("_count_range", &_SegmentedCountRange, "Counts the primes in [lo, hi), sieving only that window and the base primes up to sqrt(hi)");
+    m.def("_reduce_range", &_SegmentedReduceRange, "Reduces the primes in [lo, hi) by count, sum, sum_squares, residues (mod m), or max_gap, segment by segment");
+    m.def("_partition_range", &_PartitionRange, "Splits [lo, hi) into up to n chunks of even expected work, at segment boundaries");
+    m.def("_summarize_range", &_SummarizeRange, "Returns (count, first, last, widest gap, prime before it) for the primes in [lo, hi)");
+    m.def("_sieve_range_summary", &_SieveRangeSummary, "Returns the primes in [lo, hi) and their summary, as for _summarize_range");
+    m.def("_sieve_numpy", &_SieveOfEratosthenesNumPy, "Returns all primes up to the value of its argument, as a uint64 NumPy array");
+    m.def("_segmented_sieve_numpy", &_SegmentedSieveOfEratosthenesNumPy, "Returns the primes in capped space complexity, as a uint64 NumPy array");
+    m.def("_sieve_range_numpy", &_SegmentedSieveRangeNumPy, "Returns the primes in [lo, hi), as a uint64 NumPy array");
+    py::class_<_SegmentedSieveIterator>(m, "_SegmentedSieveIterator")
+        .def(py::init<const BigInteger&, const BigInteger&, size_t, unsigned>(), py::call_guard<EngineCall>())
+        .def("done", &_SegmentedSieveIterator::IsDone, "True once every segment has been returned")
+        .def("next", &_SegmentedSieveIterator::Next, "Returns the primes of the next segment in [lo, hi)");
+    py::class_<_PrimePatternIterator>(m, "_PrimePatternIterator")
+        .def(py::init<const BigInteger&, const BigInteger&, size_t, size_t, unsigned, unsigned>(), py::call_guard<EngineCall>())
+        .def(py::init<const BigInteger&, const BigInteger&, const std::vector<size_t>&, size_t, unsigned, unsigned>(), py::call_guard<EngineCall>())
+        .def("done", &_PrimePatternIterator::IsDone, "True once every segment has been scanned")
+        .def("next", &_PrimePatternIterator::Next, "Returns the gaps or tuples of the next batch of segments in [lo, hi)");
+    py::class_<PrimeTable>(m, "_PrimeTable")
+        .def(py::init<const std::string&>(), py::call_guard<EngineCall>())
+        .def(py::init<uint64_t, unsigned>(), py::call_guard<EngineCall>())
+        .def("bound", &PrimeTable::Bound, "The table covers [0, bound)")
+        .def("is_prime", &PrimeTable::IsPrime, "True if the argument is prime")
+        .def("count", &PrimeTable::Count, "Counts the primes up to the value of its argument")
+        .def("count_range", &PrimeTable::CountRange, "Counts the primes in [lo, hi)")
+        .def("sieve_range", &PrimeTable::SieveRange, py::call_guard<EngineCall>(), "Returns the primes in [lo, hi)")
+        .def("sieve_range_numpy", [](const PrimeTable& t, uint64_t lo, uint64_t hi) { return ToNumPy(WithoutGIL([&] { return t.SieveRange(lo, hi); })); },
+            "Returns the primes in [lo, hi), as a uint64 NumPy array");
+    py::class_<SieveMonitor>(m, "_SieveMonitor")
+        .def(py::init<>())
+        .def("cancel", &SieveMonitor::Cancel, "Stops every sieve under the monitor at its next segment, with SieveCancelled")
+        .def("cancelled", &SieveMonitor::IsCancelled, "True once cancel() is called")
+        .def("progress", &SieveMonitor::GetProgress, "The fraction of the known segments that are done, in [0, 1]")
+        .def("run", [](SieveMonitor& monitor, const py::object& fn) {
+            ScopedSieveMonitor scope(&monitor);
+            return fn();
+        }, "Calls fn() with every sieve that it begins on this thread under the monitor");
+    py::register_exception<SieveCancelled>(m, "SieveCancelled");
+    m.def("_write_prime_table", &WritePrimeTable, py::call_guard<EngineCall>(), "Writes a prime table file of every prime up to n, to map back with _PrimeTable");
+    m.def("_is_prime", &_IsPrimeBatch, "Tests each value of a list for primality, over any number of threads (0 for all)");
+    m.def("_next_prime", &_NextPrimeBatch, "Returns the least prime greater than each value of a list");
+    m.def("_prev_prime", &_PrevPrimeBatch, "Returns the greatest prime less than each value of a list (or 0 for none)");
+    m.def("_warmup", &WarmUpBasePrimes<BigInteger>, py::call_guard<EngineCall>(), "Caches every base prime needed to sieve up to the value of its argument");
+    m.def("_clear_cache", &ClearBasePrimes, py::call_guard<py::gil_scoped_release>(), "Frees the cached base primes");
+    m.def("_last_run_stats", &_LastRunStats, "Returns the phase times and counters of the last call, if built with ERATOSTHENES_STATS=1, or else None");
+    m.def("_segment_size", &NormalizeSegmentBytes, "Returns the segment size in bytes that would be used for a requested size (0 for the default)");
 }
@@ -1,23 +1,249 @@
+import concurrent.futures
+import numbers
+import os
+import threading
+import time
 import _eratosthenes
 
+__all__ = [
+    "count", "segmented_count", "sieve", "segmented_sieve",
+    "sieve_range", "count_range", "reduce_range", "segmented_reduce",
+    "sieve_range_iter", "segmented_sieve_iter",
+    "prime_gaps", "prime_gaps_iter", "prime_tuples", "prime_tuples_iter",
+    "is_prime", "next_prime", "prev_prime",
+    "warmup", "clear_cache", "write_prime_table", "PrimeTable",
+    "partition_range", "partition", "run_partition", "merge_partials",
+    "SieveCancelled", "SieveJob", "submit",
+    "last_run_stats", "segment_size", "tune_segment_size",
+]
+
+SieveCancelled = _eratosthenes.SieveCancelled
+
 def count(n):
-    return int(_eratosthenes._count(str(n)))
+    return _eratosthenes._count(int(n))
+
+def segmented_count(n, segment_size=0, threads=0, wheel=30):
+    return _eratosthenes._segmented_count(int(n), segment_size, threads, wheel)
+
+def sieve(n, numpy=False):
+    if numpy:
+        return _eratosthenes._sieve_numpy(int(n))
+
+    return _eratosthenes._sieve(int(n))
+
+def segmented_sieve(n, segment_size=0, threads=0, numpy=False, wheel=30):
+    if numpy:
+        return _eratosthenes._segmented_sieve_numpy(int(n), segment_size, threads, wheel)
+
+    return _eratosthenes._segmented_sieve(int(n), segment_size, threads, wheel)
+
+def sieve_range(lo, hi, segment_size=0, threads=0, numpy=False, wheel=30):
+    if numpy:
+        return _eratosthenes._sieve_range_numpy(max(int(lo), 0), max(int(hi), 0), segment_size, threads, wheel)
+
+    return _eratosthenes._sieve_range(max(int(lo), 0), max(int(hi), 0), segment_size, threads, wheel)
+
+def count_range(lo, hi, segment_size=0, threads=0, wheel=30):
+    return _eratosthenes._count_range(max(int(lo), 0), max(int(hi), 0), segment_size, threads, wheel)
+
+def reduce_range(lo, hi, op="count", modulus=None, segment_size=0, threads=0, wheel=30):
+    return _eratosthenes._reduce_range(max(int(lo), 0), max(int(hi), 0), op, int(modulus or 0), segment_size, threads, wheel)
+
+def segmented_reduce(n, op="count", modulus=None, segment_size=0, threads=0, wheel=30):
+    return reduce_range(0, int(n) + 1, op, modulus, segment_size, threads, wheel)
+
+def sieve_range_iter(lo, hi, segment_size=0, wheel=30):
+    it = _eratosthenes._SegmentedSieveIterator(max(int(lo), 0), max(int(hi), 0), segment_size, wheel)
+    while not it.done():
+        yield from it.next()
+
+def segmented_sieve_iter(n, segment_size=0, wheel=30):
+    return sieve_range_iter(0, int(n) + 1, segment_size, wheel)
+
+def _drain(it):
+    out = []
+    while not it.done():
+        out.extend(it.next())
+
+    return out
+
+def _stream(it):
+    while not it.done():
+        yield from it.next()
+
+def _gaps(lo, hi, min_gap, segment_size, threads, wheel):
+    return _eratosthenes._PrimePatternIterator(max(int(lo), 0), max(int(hi), 0), max(int(min_gap), 0), segment_size, threads, wheel)
+
+def _tuples(lo, hi, pattern, segment_size, threads, wheel):
+    return _eratosthenes._PrimePatternIterator(max(int(lo), 0), max(int(hi), 0), [int(d) for d in pattern], segment_size, threads, wheel)
+
+def prime_gaps(lo, hi, min_gap=1, segment_size=0, threads=0, wheel=30):
+    return _drain(_gaps(lo, hi, min_gap, segment_size, threads, wheel))
+
+def prime_gaps_iter(lo, hi, min_gap=1, segment_size=0, threads=0, wheel=30):
+    return _stream(_gaps(lo, hi, min_gap, segment_size, threads, wheel))
+
+def prime_tuples(lo, hi, pattern=(0, 2), segment_size=0, threads=0, wheel=30):
+    return _drain(_tuples(lo, hi, pattern, segment_size, threads, wheel))
+
+def prime_tuples_iter(lo, hi, pattern=(0, 2), segment_size=0, threads=0, wheel=30):
+    return _stream(_tuples(lo, hi, pattern, segment_size, threads, wheel))
+
+def _batch(f, xs, threads):
+    if isinstance(xs, numbers.Integral):
+        return f([int(xs)], threads)[0]
+
+    return f([int(x) for x in xs], threads)
+
+def is_prime(xs, threads=0):
+    return _batch(_eratosthenes._is_prime, xs, threads)
+
+def next_prime(xs, threads=0):
+    return _batch(_eratosthenes._next_prime, xs, threads)
+
+def prev_prime(xs, threads=0):
+    if isinstance(xs, numbers.Integral):
+        return _eratosthenes._prev_prime([int(xs)], threads)[0] or None
+
+    return [p or None for p in _eratosthenes._prev_prime([int(x) for x in xs], threads)]
+
+def warmup(n):
+    _eratosthenes._warmup(max(int(n), 0))
+
+def clear_cache():
+    _eratosthenes._clear_cache()
+
+def write_prime_table(path, n, threads=0):
+    _eratosthenes._write_prime_table(os.fsdecode(path), max(int(n), 0), threads)
+
+class PrimeTable:
+    def __init__(self, source, threads=0):
+        if isinstance(source, (str, bytes, os.PathLike)):
+            self._table = _eratosthenes._PrimeTable(os.fsdecode(source))
+        else:
+            self._table = _eratosthenes._PrimeTable(max(int(source), 0), threads)
+
+    @property
+    def bound(self):
+        return self._table.bound()
+
+    def is_prime(self, n):
+        n = int(n)
+        return (n >= 0) and self._table.is_prime(n)
+
+    def count(self, n):
+        n = int(n)
+        return self._table.count(n) if n >= 0 else 0
+
+    def count_range(self, lo, hi):
+        return self._table.count_range(max(int(lo), 0), max(int(hi), 0))
+
+    def sieve_range(self, lo, hi, numpy=False):
+        if numpy:
+            return self._table.sieve_range_numpy(max(int(lo), 0), max(int(hi), 0))
+
+        return self._table.sieve_range(max(int(lo), 0), max(int(hi), 0))
+
+def partition_range(lo, hi, parts, op="count", segment_size=0, wheel=30):
+    if op not in ("count", "sieve"):
+        raise ValueError("The op must be count or sieve.")
+    lo, hi = max(int(lo), 0), max(int(hi), 0)
+    # Every node must segment alike, whatever its own cache, to share the same bounds.
+    segment_bytes = _eratosthenes._segment_size(segment_size)
+    bounds = _eratosthenes._partition_range(lo, hi, max(int(parts), 1), segment_bytes, wheel)
+
+    return [{"lo": a, "hi": b, "op": op, "segment_size": segment_bytes, "wheel": wheel} for a, b in zip(bounds, bounds[1:])]
+
+def partition(n, parts, op="count", segment_size=0, wheel=30):
+    return partition_range(2, int(n) + 1, parts, op, segment_size, wheel)
+
+def _partial(chunk, summary):
+    count, first, last, max_gap, after = summary
+    return {"lo": chunk["lo"], "hi": chunk["hi"], "count": count, "first": first, "last": last, "max_gap": max_gap, "after": after}
+
+def run_partition(chunk, threads=0):
+    args = (chunk["lo"], chunk["hi"], chunk["segment_size"], threads, chunk["wheel"])
+    if chunk["op"] == "sieve":
+        primes, summary = _eratosthenes._sieve_range_summary(*args)
+        partial = _partial(chunk, summary)
+        partial["primes"] = primes
+
+        return partial
+
+    return _partial(chunk, _eratosthenes._summarize_range(*args))
+
+def merge_partials(partials):
+    parts = sorted(partials, key=lambda r: r["lo"])
+    if not parts:
+        raise ValueError("There are no partial results to merge.")
+    for a, b in zip(parts, parts[1:]):
+        if a["hi"] != b["lo"]:
+            raise ValueError("The partial results must cover one range, without gaps or overlaps.")
+
+    merged = {"lo": parts[0]["lo"], "hi": parts[-1]["hi"], "count": 0, "first": None, "last": None, "max_gap": 0, "after": None}
+    for r in parts:
+        merged["count"] += r["count"]
+        if r["first"] is None:
+            continue
+        # The widest gap is the first of any ties, across chunks as within them.
+        if (merged["last"] is not None) and ((r["first"] - merged["last"]) > merged["max_gap"]):
+            merged["max_gap"], merged["after"] = r["first"] - merged["last"], merged["last"]
+        if r["max_gap"] > merged["max_gap"]:
+            merged["max_gap"], merged["after"] = r["max_gap"], r["after"]
+        if merged["first"] is None:
+            merged["first"] = r["first"]
+        merged["last"] = r["last"]
+    if all("primes" in r for r in parts):
+        merged["primes"] = [p for r in parts for p in r["primes"]]
+
+    return merged
+
+class SieveJob(concurrent.futures.Future):
+    def __init__(self, fn, args, kwargs):
+        super().__init__()
+        self._monitor = _eratosthenes._SieveMonitor()
+        threading.Thread(target=self._run, args=(fn, args, kwargs), daemon=True).start()
+
+    def _run(self, fn, args, kwargs):
+        if not self.set_running_or_notify_cancel():
+            return
+        try:
+            self.set_result(self._monitor.run(lambda: fn(*args, **kwargs)))
+        except BaseException as e:
+            self.set_exception(e)
+
+    def stop(self):
+        # A running sieve stops at its next segment, and raises SieveCancelled.
+        self._monitor.cancel()
+
+    def cancel(self):
+        # The thread starts with the job, so it is rarely still pending, to
+        # cancel as a Future. A running job stops, as by stop(), instead, (and
+        # this returns False, as its result() raises SieveCancelled.)
+        self.stop()
+        return super().cancel()
+
+    def progress(self):
+        return 1.0 if self.done() else self._monitor.progress()
 
-def segmented_count(n):
-    return int(_eratosthenes._segmented_count(str(n)))
+def submit(fn, *args, **kwargs):
+    return SieveJob(fn, args, kwargs)
 
-def sieve(n):
-    v = _eratosthenes._sieve(str(n))
-    l = []
-    for p in v:
-        l.append(int(p))
+def last_run_stats():
+    return _eratosthenes._last_run_stats()
 
-    return l
+def segment_size(segment_size=0):
+    return _eratosthenes._segment_size(segment_size)
 
-def segmented_sieve(n):
-    v = _eratosthenes._segmented_sieve(str(n))
-    l = []
-    for p in v:
-        l.append(int(p))
+def tune_segment_size(n=1000000000, sizes=None):
+    if sizes is None:
+        sizes = [1 << s for s in range(15, 24)]
+    timings = {}
+    for s in sizes:
+        s = segment_size(s)
+        start = time.perf_counter()
+        # (segmented_count() would count by LMO instead, past 10^7.)
+        count_range(0, int(n) + 1, s, 1)
+        timings[s] = time.perf_counter() - start
 
-    return l
\ No newline at end of file
+    return min(timings, key=timings.get), timings
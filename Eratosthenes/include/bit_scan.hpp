@@ -0,0 +1,258 @@
+// Scan kernels for the final pass over a sieved bit set.
+//
+// Counting takes a population count of whole 64-bit words, (and of
+// whole vectors of them, where the CPU has the instructions,) picked
+// once per process by runtime CPU dispatch: AVX-512 VPOPCNTDQ, then
+// AVX2, then the scalar POPCNT instruction, on x86-64, or NEON on
+// AArch64. Extraction visits only the clear bits, by bit scans of
+// whole words, so its cost is per prime, not per candidate.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define QIMCIFA_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define QIMCIFA_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace qimcifa {
+
+// Loads 8 bytes of a bit set as a word, so that bit i of the word is
+// bit (i & 7) of byte (i >> 3), whatever the byte order of the host.
+inline uint64_t LoadBitWord(const unsigned char* bytes)
+{
+    uint64_t w;
+    std::memcpy(&w, bytes, sizeof(w));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    w = __builtin_bswap64(w);
+#endif
+
+    return w;
+}
+
+inline unsigned PopCountWord(uint64_t w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(w);
+#else
+    unsigned c = 0U;
+    for (; w; w &= w - 1U) {
+        ++c;
+    }
+    return c;
+#endif
+}
+
+inline unsigned CountTrailingZeros(const uint64_t& w)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(w);
+#else
+    unsigned c = 0U;
+    for (uint64_t v = w; !(v & 1U); v >>= 1U) {
+        ++c;
+    }
+    return c;
+#endif
+}
+
+// Counts the set bits in the first "count" bytes of "bytes."
+inline size_t PopCountBytesScalar(const unsigned char* bytes, const size_t& count)
+{
+    size_t c = 0U, i = 0U;
+    for (; (i + 8U) <= count; i += 8U) {
+        c += PopCountWord(LoadBitWord(bytes + i));
+    }
+    for (; i < count; ++i) {
+        c += PopCountWord(bytes[i]);
+    }
+
+    return c;
+}
+
+#if defined(QIMCIFA_X86_DISPATCH)
+__attribute__((target("popcnt"))) inline size_t PopCountBytesPOPCNT(const unsigned char* bytes, const size_t& count)
+{
+    size_t c = 0U, i = 0U;
+    for (; (i + 8U) <= count; i += 8U) {
+        uint64_t w;
+        std::memcpy(&w, bytes + i, sizeof(w));
+        c += (size_t)_mm_popcnt_u64(w);
+    }
+    for (; i < count; ++i) {
+        c += (size_t)_mm_popcnt_u32(bytes[i]);
+    }
+
+    return c;
+}
+
+// (This is the nibble lookup method, with sums of absolute differences.)
+__attribute__((target("avx2,popcnt"))) inline size_t PopCountBytesAVX2(const unsigned char* bytes, const size_t& count)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2,
+        3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0U;
+    while ((i + 32U) <= count) {
+        // Byte counts of up to 8 are summed over at most 31 vectors,
+        // before they could overflow, and then widened to 64 bits.
+        __m256i acc = _mm256_setzero_si256();
+        for (size_t j = 0U; (j < 31U) && ((i + 32U) <= count); ++j, i += 32U) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+            const __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+            const __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+            acc = _mm256_add_epi8(acc, _mm256_add_epi8(lo, hi));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, _mm256_setzero_si256()));
+    }
+
+    size_t c = (size_t)_mm256_extract_epi64(total, 0) + (size_t)_mm256_extract_epi64(total, 1) +
+        (size_t)_mm256_extract_epi64(total, 2) + (size_t)_mm256_extract_epi64(total, 3);
+
+    return c + PopCountBytesPOPCNT(bytes + i, count - i);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt"))) inline size_t PopCountBytesAVX512(
+    const unsigned char* bytes, const size_t& count)
+{
+    __m512i total = _mm512_setzero_si512();
+    size_t i = 0U;
+    for (; (i + 64U) <= count; i += 64U) {
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(_mm512_loadu_si512(bytes + i)));
+    }
+
+    uint64_t lanes[8U];
+    _mm512_storeu_si512(lanes, total);
+    size_t c = 0U;
+    for (const uint64_t& lane : lanes) {
+        c += (size_t)lane;
+    }
+
+    return c + PopCountBytesPOPCNT(bytes + i, count - i);
+}
+#endif
+
+#if defined(QIMCIFA_NEON)
+inline size_t PopCountBytesNEON(const unsigned char* bytes, const size_t& count)
+{
+    uint64x2_t total = vdupq_n_u64(0U);
+    size_t i = 0U;
+    for (; (i + 16U) <= count; i += 16U) {
+        total = vpadalq_u32(total, vpaddlq_u16(vpaddlq_u8(vcntq_u8(vld1q_u8(bytes + i)))));
+    }
+
+    return (size_t)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1)) + PopCountBytesScalar(bytes + i, count - i);
+}
+#endif
+
+typedef size_t (*PopCountBytesFn)(const unsigned char*, const size_t&);
+
+// Returns the fastest population count kernel for this CPU, chosen once.
+inline PopCountBytesFn GetPopCountBytesKernel()
+{
+    static const PopCountBytesFn kernel = [] {
+#if defined(QIMCIFA_X86_DISPATCH)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512vpopcntdq")) {
+            return &PopCountBytesAVX512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+            return &PopCountBytesAVX2;
+        }
+        if (__builtin_cpu_supports("popcnt")) {
+            return &PopCountBytesPOPCNT;
+        }
+#elif defined(QIMCIFA_NEON)
+        return &PopCountBytesNEON;
+#endif
+        return &PopCountBytesScalar;
+    }();
+
+    return kernel;
+}
+
+// Counts the clear bits of bit set "bits" in [first, last).
+inline size_t CountClearBits(const unsigned char* bits, const size_t& first, const size_t& last)
+{
+    if (first >= last) {
+        return 0U;
+    }
+
+    size_t set = 0U;
+    size_t b = first >> 3U;
+    const size_t e = last >> 3U;
+    if (b == e) {
+        const unsigned mask = ((1U << (last & 7U)) - 1U) & ~((1U << (first & 7U)) - 1U);
+        return (last - first) - PopCountWord(bits[b] & mask);
+    }
+    if (first & 7U) {
+        set += PopCountWord(bits[b] & ~((1U << (first & 7U)) - 1U) & 0xffU);
+        ++b;
+    }
+    set += GetPopCountBytesKernel()(bits + b, e - b);
+    if (last & 7U) {
+        set += PopCountWord(bits[e] & ((1U << (last & 7U)) - 1U));
+    }
+
+    return (last - first) - set;
+}
+
+// Calls fn(o) for each bit "o" of bit set "bits" in [first, last) that
+// is clear, (or set, if IsSet,) in order. (The bit set must have whole
+// bytes up to bit "last".)
+template <bool IsSet, typename Fn>
+inline void ForEachBit(const unsigned char* bits, const size_t& first, const size_t& last, Fn fn)
+{
+    if (first >= last) {
+        return;
+    }
+
+    const uint64_t flip = IsSet ? 0U : ~(uint64_t)0U;
+    const size_t lastByte = (last + 7U) >> 3U;
+    size_t b = first >> 3U;
+    while (b < lastByte) {
+        const size_t width = ((lastByte - b) < 8U) ? (lastByte - b) : 8U;
+        uint64_t w;
+        if (width == 8U) {
+            w = flip ^ LoadBitWord(bits + b);
+        } else {
+            w = 0U;
+            for (size_t i = 0U; i < width; ++i) {
+                w |= (uint64_t)(unsigned char)(flip ^ bits[b + i]) << (i << 3U);
+            }
+        }
+
+        const size_t o = b << 3U;
+        // Mask off anything outside [first, last).
+        if (first > o) {
+            w &= ~(uint64_t)0U << (first - o);
+        }
+        if ((last - o) < 64U) {
+            w &= ((uint64_t)1U << (last - o)) - 1U;
+        }
+
+        for (; w; w &= w - 1U) {
+            fn(o + CountTrailingZeros(w));
+        }
+        b += width;
+    }
+}
+
+template <typename Fn> inline void ForEachClearBit(const unsigned char* bits, const size_t& first, const size_t& last, Fn fn)
+{
+    ForEachBit<false>(bits, first, last, fn);
+}
+
+template <typename Fn> inline void ForEachSetBit(const unsigned char* bits, const size_t& first, const size_t& last, Fn fn)
+{
+    ForEachBit<true>(bits, first, last, fn);
+}
+} // namespace qimcifa
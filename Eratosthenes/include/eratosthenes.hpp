@@ -0,0 +1,1477 @@
+// Source: https://www.geeksforgeeks.org/sieve-of-eratosthenes/
+// C++ program to print all primes smaller than or equal to
+// n using Sieve of Eratosthenes
+
+// Improved by Dan Strano of Unitary Fund, 2024.
+// We can think of trial division as exact inverse of
+// Sieve of Eratosthenes, with log space and log time.
+// The modular division part is a costly atomic operation.
+// It need only be carried out up the square root of the
+// number under trial. Multiples of 2, 3, 5, 7, and 11 can
+// be entirely skipped in loop enumeration.
+
+// Every routine here is templated on its integer type.
+// uint64_t is the fast path, and BigInteger is only for
+// bounds that genuinely do not fit a native word. (Either
+// way, no index into the sieve storage exceeds size_t.)
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#include <sys/types.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include "bit_scan.hpp"
+#include "parallel_for.hpp"
+#include "sieve_stats.hpp"
+
+namespace qimcifa {
+
+typedef boost::multiprecision::cpp_int BigInteger;
+
+// Returns floor(sqrt(n)), by Newton's method, for any unsigned type.
+template <typename BigInt> inline BigInt sqrt(const BigInt& n)
+{
+    if (n < 2U) {
+        return n;
+    }
+
+    // From any start above the root, the iterates fall to it monotonically.
+    BigInt x = n;
+    BigInt y = (x >> 1U) + (x & 1U);
+    while (y < x) {
+        x = y;
+        y = (x + n / x) >> 1U;
+    }
+
+    return x;
+}
+
+// Returns floor(sqrt(n)) for a native word, from the hardware square
+// root, with a correction for any rounding, (e.g., where long double
+// is no wider than double).
+inline uint64_t sqrt(const uint64_t& n)
+{
+    constexpr uint64_t maxRoot = 0xFFFFFFFFULL;
+    uint64_t r = (uint64_t)std::sqrt((long double)n);
+    if (r > maxRoot) {
+        r = maxRoot;
+    }
+    while ((r * r) > n) {
+        --r;
+    }
+    while ((r < maxRoot) && (((r + 1U) * (r + 1U)) <= n)) {
+        ++r;
+    }
+
+    return r;
+}
+
+inline BigInteger sqrt(const BigInteger& n) { return BigInteger(boost::multiprecision::sqrt(n)); }
+
+// We are multiplying out the first distinct primes, below.
+
+// Make this NOT a multiple of 2.
+template <typename BigInt> inline BigInt forward2(const size_t& p) { return (BigInt)((p << 1U) | 1U); }
+
+template <typename BigInt> inline size_t backward2(const BigInt& p) { return (size_t)(p >> 1U); }
+
+// Make this NOT a multiple of 2 or 3.
+template <typename BigInt> inline BigInt forward3(const size_t& p) { return (BigInt)((p << 1U) + (~(~p | 1U)) - 1U); }
+
+template <typename BigInt> inline size_t backward3(const BigInt& n) { return (size_t)((~(~n | 1U)) / 3U) + 1U; }
+
+constexpr size_t GreatestCommonDivisor(size_t a, size_t b)
+{
+    while (b) {
+        const size_t r = a % b;
+        a = b;
+        b = r;
+    }
+
+    return a;
+}
+
+// The count of residues coprime to "modulus," in [1, modulus)
+constexpr size_t CountCoprimeResidues(const size_t& modulus)
+{
+    size_t count = 0U;
+    for (size_t r = 1U; r < modulus; ++r) {
+        if (GreatestCommonDivisor(r, modulus) == 1U) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+// The residues of a wheel of primorial "Modulus," (30, 210, 2310, ...,)
+// built at compile time, with their inverse, so that a value maps to its
+// candidate index by one table load, rather than by a search.
+template <size_t Modulus> struct WheelResidues {
+    typedef typename std::conditional<(Modulus < 256U), unsigned char, unsigned short>::type Entry;
+    static constexpr size_t count = CountCoprimeResidues(Modulus);
+    // residue[k] is the k-th residue coprime to Modulus, in order.
+    Entry residue[count];
+    // index[r] is the 0-based index of the first residue at or above r.
+    Entry index[Modulus + 1U];
+
+    constexpr WheelResidues()
+        : residue()
+        , index()
+    {
+        size_t k = 0U;
+        for (size_t r = 0U; r <= Modulus; ++r) {
+            index[r] = (Entry)k;
+            if ((r < Modulus) && (GreatestCommonDivisor(r, Modulus) == 1U)) {
+                residue[k++] = (Entry)r;
+            }
+        }
+    }
+};
+
+template <size_t Modulus> constexpr WheelResidues<Modulus> wheelResidues = WheelResidues<Modulus>();
+
+// Maps the 0-based candidate index p of the wheel of Modulus to its value.
+template <size_t Modulus, typename BigInt> inline BigInt WheelForward(const size_t& p)
+{
+    constexpr size_t count = WheelResidues<Modulus>::count;
+    return wheelResidues<Modulus>.residue[p % count] + (BigInt)(p / count) * Modulus;
+}
+
+// Maps n to the 1-based index of the first candidate of the wheel of
+// Modulus at or above it.
+template <size_t Modulus, typename BigInt> inline size_t WheelBackward(const BigInt& n)
+{
+    return wheelResidues<Modulus>.index[(size_t)(n % Modulus)] + WheelResidues<Modulus>::count * (size_t)(n / Modulus) + 1U;
+}
+
+// Make this NOT a multiple of 2, 3, or 5.
+template <typename BigInt> inline BigInt forward5(const size_t& p) { return WheelForward<30U, BigInt>(p); }
+
+template <typename BigInt> inline size_t backward5(const BigInt& n) { return WheelBackward<30U>(n); }
+
+// Make this NOT a multiple of 2, 3, 5, or 7.
+template <typename BigInt> inline BigInt forward7(const size_t& p) { return WheelForward<210U, BigInt>(p); }
+
+template <typename BigInt> inline size_t backward7(const BigInt& n) { return WheelBackward<210U>(n); }
+
+// Make this NOT a multiple of 2, 3, 5, 7, or 11.
+template <typename BigInt> inline BigInt forward11(const size_t& p) { return WheelForward<2310U, BigInt>(p); }
+
+template <typename BigInt> inline size_t backward11(const BigInt& n) { return WheelBackward<2310U>(n); }
+
+// A wheel of the first "PrimeCount" primes, whose product is Modulus.
+// Segmented sieve storage holds only the candidates coprime to it, at
+// one bit each, so every period of the wheel fills a whole number of bytes.
+template <size_t Modulus, size_t PrimeCount> struct Wheel {
+    static constexpr size_t modulus = Modulus;
+    static constexpr size_t count = WheelResidues<Modulus>::count;
+    static constexpr size_t primeCount = PrimeCount;
+    static constexpr size_t periodBytes = count >> 3U;
+
+    static constexpr size_t Residue(const size_t& k) { return wheelResidues<Modulus>.residue[k]; }
+
+    // The 0-based index of the first residue at or above r, in [0, modulus]
+    static constexpr size_t Index(const size_t& r) { return wheelResidues<Modulus>.index[r]; }
+
+    // The offset of the 0-indexed candidate "o" from the start of its period 0
+    static size_t Forward(const size_t& o) { return (o / count) * Modulus + wheelResidues<Modulus>.residue[o % count]; }
+};
+
+typedef Wheel<30U, 3U> Wheel30;
+typedef Wheel<210U, 4U> Wheel210;
+
+// Lookup tables for a Wheel, so that no sieve needs to search its residues.
+template <typename W> struct WheelTables {
+    // gap[k] is the distance from residue k to the next (or to 1 past the modulus).
+    unsigned char gap[W::count];
+    // For a prime of residue index i, and its multiplier at residue index
+    // k, the multiple falls at byte[i][k] of its period, under mask[i][k].
+    // Stepping the multiplier on to the next residue then moves it through
+    // carry[i][k] more periods than (p / modulus) * gap[k].
+    unsigned char byte[W::count][W::count];
+    unsigned char mask[W::count][W::count];
+    unsigned char carry[W::count][W::count];
+
+    constexpr WheelTables()
+        : gap()
+        , byte()
+        , mask()
+        , carry()
+    {
+        for (size_t k = 0U; k < W::count; ++k) {
+            gap[k] = (unsigned char)((((k + 1U) < W::count) ? W::Residue(k + 1U) : (W::modulus + 1U)) - W::Residue(k));
+        }
+        for (size_t i = 0U; i < W::count; ++i) {
+            for (size_t k = 0U; k < W::count; ++k) {
+                const size_t r = (W::Residue(i) * W::Residue(k)) % W::modulus;
+                byte[i][k] = (unsigned char)(W::Index(r) >> 3U);
+                mask[i][k] = (unsigned char)(1U << (W::Index(r) & 7U));
+                carry[i][k] = (unsigned char)((r + W::Residue(i) * gap[k]) / W::modulus);
+            }
+        }
+    }
+};
+
+template <typename W> constexpr WheelTables<W> wheelTables = WheelTables<W>();
+
+// The greatest root, sqrt(hi) + 1, of a window that SieveWindow sieves
+constexpr uint64_t maxSieveRoot = (1ULL << 32U) + 1U;
+
+// The count of bits needed to hold n
+constexpr size_t BitLength(size_t n)
+{
+    size_t bits = 0U;
+    while (n) {
+        ++bits;
+        n >>= 1U;
+    }
+
+    return bits;
+}
+
+// A sieving prime, with its own place on wheel W, so that crossing
+// off its multiples takes no division and no remainder tests. (A table
+// of these can hold all ~2e8 base primes of a window near 2^64, so each
+// is packed into 32 bits, and p itself is rebuilt from q and r.)
+template <typename W> struct WheelPrime {
+    static constexpr size_t rBits = BitLength(W::count - 1U);
+    static_assert(BitLength(maxSieveRoot / W::modulus) <= (32U - rBits), "Every base prime of a window must fit in a WheelPrime.");
+
+    // p / W::modulus
+    uint32_t q : 32U - rBits;
+    // The index of the residue p % W::modulus
+    uint32_t r : rBits;
+
+    explicit WheelPrime(const size_t& prime)
+        : q((uint32_t)(prime / W::modulus))
+        , r((uint32_t)W::Index(prime % W::modulus))
+    {
+        // Intentionally left blank
+    }
+
+    size_t P() const { return (size_t)q * W::modulus + W::Residue(r); }
+};
+
+// The next multiple of a sieving prime: its period from the start of the
+// segment, and the residue index of its multiplier on the wheel.
+struct WheelMultiple {
+    size_t period;
+    size_t c;
+};
+
+// The next multiple of a large sieving prime, waiting in the bucket of
+// the segment it falls in, with its period from the start of that segment
+struct BucketHit {
+    uint32_t k;
+    uint32_t period;
+    uint32_t c;
+};
+
+// Where one thread's sieve stands within a window. "next" holds the next
+// multiple of each small sieving prime that has come within the square
+// root of a segment so far, relative to the start of "segment". The
+// "largeCount" large primes that have come within it wait, instead, in
+// a ring of buckets, one per segment, from "head" for "segment" itself.
+// Sieving segments in order carries all of it forward, and any other
+// order just starts it over.
+struct SieveCursor {
+    size_t segment;
+    std::vector<WheelMultiple> next;
+    size_t largeCount;
+    size_t head;
+    std::vector<std::vector<BucketHit>> buckets;
+
+    // (A new cursor stands at no segment at all.)
+    SieveCursor()
+        : segment(~(size_t)0U)
+        , largeCount(0U)
+        , head(0U)
+    {
+        // Intentionally left blank
+    }
+
+    void Reset(const size_t& bucketCount)
+    {
+        next.clear();
+        largeCount = 0U;
+        head = 0U;
+        if (buckets.size() != bucketCount) {
+            buckets.resize(bucketCount);
+        }
+        for (std::vector<BucketHit>& bucket : buckets) {
+            bucket.clear();
+        }
+    }
+
+    // Files a hit "period" periods past the start of the current segment,
+    // where every segment up to it is whole, of "periods" periods.
+    void Push(const size_t& k, const size_t& period, const size_t& c, const size_t& periods)
+    {
+        const size_t j = period / periods;
+        buckets[(head + j) % buckets.size()].push_back(BucketHit{ (uint32_t)k, (uint32_t)(period - j * periods), (uint32_t)c });
+    }
+};
+
+// Sieve storage is a bit set of wheel5 candidates, indexed
+// by backward5(n) - 1U, so that each byte covers exactly 30
+// integers, and bit k of a byte stands for Wheel30::Residue(k).
+inline bool IsBitSet(const unsigned char* bits, const size_t& i) { return (bits[i >> 3U] >> (i & 7U)) & 1U; }
+
+inline void SetBit(unsigned char* bits, const size_t& i) { bits[i >> 3U] |= (unsigned char)(1U << (i & 7U)); }
+
+// Returns the L2 cache size (per core) in bytes, or 0 if unknown.
+inline size_t DetectL2CacheBytes()
+{
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 > 0) {
+        return (size_t)l2;
+    }
+#endif
+#if defined(__linux__)
+    // Older glibc (or musl) might not report it, but sysfs does.
+    for (size_t i = 0U; i < 8U; ++i) {
+        const std::string path = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string(i) + "/";
+        std::ifstream levelFile(path + "level");
+        std::ifstream typeFile(path + "type");
+        std::ifstream sizeFile(path + "size");
+        size_t level = 0U;
+        std::string type, size;
+        if (!(levelFile >> level) || !(typeFile >> type) || !(sizeFile >> size)) {
+            break;
+        }
+        if ((level != 2U) || (type == "Instruction")) {
+            continue;
+        }
+        size_t bytes = std::stoull(size);
+        if (size.back() == 'K') {
+            bytes <<= 10U;
+        } else if (size.back() == 'M') {
+            bytes <<= 20U;
+        }
+
+        return bytes;
+    }
+#elif defined(__APPLE__)
+    uint64_t l2 = 0U;
+    size_t l2Size = sizeof(l2);
+    if (!sysctlbyname("hw.l2cachesize", &l2, &l2Size, NULL, 0) && l2) {
+        return (size_t)l2;
+    }
+#endif
+
+    return 0U;
+}
+
+// Returns the default segment bit set size in bytes, detected once.
+inline size_t GetSegmentBytes()
+{
+    // If we can't find out, assume the L2 cache is 1024 KB.
+    static const size_t segmentBytes = [] {
+        const size_t l2 = DetectL2CacheBytes();
+        return l2 ? l2 : ((size_t)1U << 20U);
+    }();
+
+    return segmentBytes;
+}
+
+// Rounds a requested segment size to whole 64-byte cache lines,
+// within sensible bounds, or returns the default if it's 0.
+inline size_t NormalizeSegmentBytes(size_t segmentBytes)
+{
+    constexpr size_t minBytes = 1U << 12U;
+    constexpr size_t maxBytes = 1U << 26U;
+    if (!segmentBytes) {
+        segmentBytes = GetSegmentBytes();
+    }
+    segmentBytes = std::min(std::max(segmentBytes, minBytes), maxBytes);
+
+    return segmentBytes & ~(size_t)63U;
+}
+
+// Segment bit sets are reused between segments, and between calls
+// on the same thread, rather than declared as a (non-standard, and
+// stack-overflowing) variable-length array on every iteration.
+inline unsigned char* GetSegmentBuffer(const size_t& bytes)
+{
+    thread_local std::vector<unsigned char> buffer;
+    if (buffer.size() < bytes) {
+        QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_BYTES_ALLOCATED, bytes - buffer.size()));
+        buffer.resize(bytes);
+    }
+
+    return buffer.data();
+}
+
+inline size_t GetWheel5and7Increment(unsigned short& wheel5, unsigned long long& wheel7) {
+    constexpr unsigned short wheel5Back = 1U << 9U;
+    constexpr unsigned long long wheel7Back = 1ULL << 55U;
+    unsigned wheelIncrement = 0U;
+    bool is_wheel_multiple = false;
+    do {
+        is_wheel_multiple = (bool)(wheel5 & 1U);
+        wheel5 >>= 1U;
+        if (is_wheel_multiple) {
+            wheel5 |= wheel5Back;
+            ++wheelIncrement;
+            continue;
+        }
+
+        is_wheel_multiple = (bool)(wheel7 & 1U);
+        wheel7 >>= 1U;
+        if (is_wheel_multiple) {
+            wheel7 |= wheel7Back;
+        }
+        ++wheelIncrement;
+    } while (is_wheel_multiple);
+
+    return (size_t)wheelIncrement;
+}
+
+// Returns the 0-indexed offset of the first candidate of wheel W at
+// or above n, counting from "base" (which must be a multiple of W).
+template <typename W, typename BigInt> inline size_t GetCandidateOffset(const BigInt& base, const BigInt& n)
+{
+    if (n <= base) {
+        return 0U;
+    }
+    const size_t d = (size_t)(n - base);
+
+    return (d / W::modulus) * W::count + W::Index(d % W::modulus);
+}
+
+// The multiples of the primes past wheel W, up to 19, repeat every
+// "periodCount" periods of the wheel (i.e., 7 * 11 * 13 * 17 * 19 of them,
+// or 323323 bytes, for Wheel30). Every sieve starts its bit set as a copy
+// of that pattern, rather than as zeroes, so those primes, which would
+// otherwise make the most writes of all, never need crossing off.
+template <typename W> struct PresievePattern {
+    std::vector<size_t> primes;
+    size_t periodCount;
+    std::vector<unsigned char> bits;
+
+    PresievePattern()
+        : periodCount(1U)
+    {
+        for (const size_t p : { 7U, 11U, 13U, 17U, 19U }) {
+            if (W::modulus % p) {
+                primes.push_back(p);
+                periodCount *= p;
+            }
+        }
+        bits.resize(periodCount * W::periodBytes);
+        for (size_t o = 0U; o < (periodCount * W::count); ++o) {
+            const size_t v = W::Forward(o);
+            for (const size_t& p : primes) {
+                if (!(v % p)) {
+                    SetBit(bits.data(), o);
+                    break;
+                }
+            }
+        }
+    }
+};
+
+template <typename W> inline const PresievePattern<W>& GetPresievePattern()
+{
+    static const PresievePattern<W> pattern;
+    return pattern;
+}
+
+// Starts the bit set of the "periodCount" periods of wheel W from fLo
+// (a multiple of W) as the presieve pattern. (The presieved primes are
+// themselves marked there, so they are cleared again, if they are in it.)
+template <typename W, typename BigInt>
+void Presieve(unsigned char* notPrime, const BigInt& fLo, const size_t& periodCount)
+{
+    const PresievePattern<W>& pattern = GetPresievePattern<W>();
+    const size_t patternBytes = pattern.bits.size();
+    const size_t bytes = periodCount * W::periodBytes;
+    size_t offset = (size_t)((fLo / W::modulus) % pattern.periodCount) * W::periodBytes;
+    for (size_t b = 0U; b < bytes;) {
+        const size_t length = std::min(bytes - b, patternBytes - offset);
+        std::copy(pattern.bits.begin() + offset, pattern.bits.begin() + offset + length, notPrime + b);
+        b += length;
+        offset = 0U;
+    }
+
+    if (fLo == 0U) {
+        for (const size_t& p : pattern.primes) {
+            const size_t o = (p / W::modulus) * W::count + W::Index(p % W::modulus);
+            if (o < (bytes << 3U)) {
+                notPrime[o >> 3U] &= (unsigned char)~(1U << (o & 7U));
+            }
+        }
+    }
+}
+
+template <typename BigInt> std::vector<BigInt> SieveOfEratosthenes(const BigInt& n)
+{
+    std::vector<BigInt> knownPrimes = { 2U, 3U, 5U, 7U };
+    if (n < 2U) {
+        return std::vector<BigInt>();
+    }
+
+    if (n < (knownPrimes.back() + 2U)) {
+        const auto highestPrimeIt = std::upper_bound(knownPrimes.begin(), knownPrimes.end(), n);
+        return std::vector<BigInt>(knownPrimes.begin(), highestPrimeIt);
+    }
+
+    knownPrimes.reserve(std::expint(log((double)n)) - std::expint(log(2)));
+
+    // We are excluding multiples of the first few
+    // small primes from outset. For multiples of
+    // 2, 3, and 5 this reduces complexity to 4/15.
+    const size_t cardinality = backward5(n);
+
+    // Create a bit set "prime[0..cardinality)" and
+    // initialize all entries it as true. Rather,
+    // reverse the true/false meaning, so we can use
+    // default initialization. A bit in notPrime[i]
+    // will finally be false only if i is a prime.
+    // (One byte holds the 8 wheel5 residues of 30.)
+    // The multiples of 7 through 19 are presieved.
+    std::unique_ptr<unsigned char[]> uNotPrime(new unsigned char[(cardinality + 7U) >> 3U]);
+    unsigned char* notPrime = uNotPrime.get();
+    Presieve<Wheel30>(notPrime, (BigInt)0U, (cardinality + 7U) >> 3U);
+
+    // Get the remaining prime numbers.
+    // These wheel initializations are simply correct and optimal.
+    // The integral form is rather a distinguishable bit set form.
+    unsigned short wheel5 = 129U;
+    unsigned long long wheel7 = 9009416540524545ULL;
+    size_t o = 1U;
+    for (;;) {
+        o += GetWheel5and7Increment(wheel5, wheel7);
+
+        const BigInt p = forward3<BigInt>(o);
+        if ((p * p) > n) {
+            break;
+        }
+
+        if (IsBitSet(notPrime, backward5(p) - 1U)) {
+            continue;
+        }
+
+        knownPrimes.push_back(p);
+        if (p <= 19U) {
+            continue;
+        }
+
+        // We are skipping multiples of 2, 3, and 5
+        // for space complexity, for 4/15 the bits.
+        // More are skipped by the wheel for time.
+        const BigInt p2 = p << 1U;
+        const BigInt p4 = p << 2U;
+        BigInt i = p * p;
+
+        // "p" already definitely not a multiple of 3.
+        // Its remainder when divided by 3 can be 1 or 2.
+        // If it is 2, we can do a "half iteration" of the
+        // loop that would handle remainder of 1, and then
+        // we can proceed with the 1 remainder loop.
+        // This saves 2/3 of updates (or modulo).
+        if ((p % 3U) == 2U) {
+            SetBit(notPrime, backward5(i) - 1U);
+            i += p2;
+            if (i > n) {
+                continue;
+            }
+        }
+
+        for (;;) {
+            if (i % 5U) {
+                SetBit(notPrime, backward5(i) - 1U);
+            }
+            i += p4;
+            if (i > n) {
+                break;
+            }
+
+            if (i % 5U) {
+                SetBit(notPrime, backward5(i) - 1U);
+            }
+            i += p2;
+            if (i > n) {
+                break;
+            }
+        }
+    }
+
+    // Past the square root, every clear bit up to n is a prime.
+    // (The multiples of 7 were presieved, so they need no skipping.)
+    ForEachClearBit(notPrime, backward5(forward3<BigInt>(o)) - 1U, GetCandidateOffset<Wheel30>((BigInt)0U, (BigInt)(n + 1U)),
+        [&](const size_t& i) { knownPrimes.push_back(forward5<BigInt>(i)); });
+
+    return knownPrimes;
+}
+
+// Returns a + b, or the greatest word, for a sum past it.
+template <typename BigInt> inline BigInt SaturatingAdd(const BigInt& a, const BigInt& b) { return a + b; }
+
+inline uint64_t SaturatingAdd(const uint64_t& a, const uint64_t& b) { return (a > ~b) ? ~(uint64_t)0U : (a + b); }
+
+// Returns the period of the first multiple of sieving prime p, from fLo,
+// that is at least fLo and at least p * p, and sets "c" to the residue
+// index of its multiplier on wheel W.
+template <typename W, typename BigInt> inline size_t GetFirstMultiple(const BigInt& fLo, const size_t& p, size_t& c)
+{
+    // Find the minimum multiplier m, so that p * m is in
+    // [low..high]. (Anything below p * p has a smaller
+    // factor, and p itself is prime.) Only multipliers that
+    // are candidates of the wheel give candidate multiples.
+    // (fLo + p - 1 could wrap a word, within p of 2^64.)
+    BigInt m = fLo / p;
+    if ((m * p) != fLo) {
+        ++m;
+    }
+    if (m < p) {
+        m = p;
+    }
+    c = W::Index((size_t)(m % W::modulus));
+    m = (m / W::modulus) * W::modulus;
+    if (c == W::count) {
+        m += W::modulus;
+        c = 0U;
+    }
+    m += W::Residue(c);
+
+    // p * m can pass 2^64, near there, but it is less than p * (W + 1)
+    // past fLo, so the difference is exact, even as it wraps.
+    return (size_t)(p * m - fLo) / W::modulus;
+}
+
+// Crosses off the multiples of the sieving primes (i.e., from 7 or 11,
+// up to the square root of the segment's end) among the first
+// "cardinality" candidates of wheel W above fLo, as bits of notPrime
+// from bit 0. fLo must be a multiple of W, and then every multiple is
+// tracked as a native offset from it, even when BigInt is not native.
+// The cursor must stand at the start of this segment, (or else be just
+// reset,) and it is left standing at the start of the next, which is
+// "periods" periods on. Only the first sievingCount of sievingPrimes
+// are sieved, and those from sievingPrimes[largeBegin] on are "large,"
+// and sieved from buckets, up to the end of the window, which is
+// "windowPeriods" periods on.
+template <typename W, typename BigInt>
+void SieveSegment(unsigned char* notPrime, const BigInt& fLo, const size_t& cardinality, const size_t& periods,
+    const size_t& windowPeriods, const std::vector<WheelPrime<W>>& sievingPrimes, const size_t& sievingCount,
+    const size_t& largeBegin, SieveCursor& cursor)
+{
+    const WheelTables<W>& tables = wheelTables<W>;
+    std::vector<WheelMultiple>& next = cursor.next;
+    // (Bits past cardinality, in the last period, are ignored.)
+    const size_t periodCount = (cardinality + W::count - 1U) / W::count;
+    // (The last period can pass 2^64, just below it.)
+    const BigInt fHi = SaturatingAdd(fLo, (BigInt)(periodCount * W::modulus));
+    QIMCIFA_STAT(SieveStatClock clock; uint64_t writes = 0U);
+
+    Presieve<W>(notPrime, fLo, periodCount);
+
+    // Only a prime that (newly) has p * p below the end of the
+    // segment needs to find its first multiple by division.
+    while (next.size() < largeBegin) {
+        const size_t p = sievingPrimes[next.size()].P();
+        if (((BigInt)p * p) >= fHi) {
+            break;
+        }
+        size_t c;
+        const size_t period = GetFirstMultiple<W>(fLo, p, c);
+        next.push_back(WheelMultiple{ period, c });
+    }
+    QIMCIFA_STAT(clock.Lap(SIEVE_PHASE_SETUP));
+
+    // Use the primes found by the simple sieve
+    // to find primes in current range
+    // (past those already presieved)
+    for (size_t k = std::min(GetPresievePattern<W>().primes.size(), next.size()); k < next.size(); ++k) {
+        const WheelPrime<W>& wp = sievingPrimes[k];
+        const size_t p = wp.P();
+        const size_t q = wp.q;
+        const unsigned char* byte = tables.byte[wp.r];
+        const unsigned char* mask = tables.mask[wp.r];
+        const unsigned char* carry = tables.carry[wp.r];
+        size_t period = next[k].period;
+        size_t c = next[k].c;
+
+        // From here, stepping the multiplier through the wheel
+        // residues lands only on candidates, with only adds.
+        while (c && (period < periodCount)) {
+            notPrime[period * W::periodBytes + byte[c]] |= mask[c];
+            QIMCIFA_STAT(++writes);
+            period += q * tables.gap[c] + carry[c];
+            if (++c == W::count) {
+                c = 0U;
+            }
+        }
+
+        if (!c) {
+            // Each whole turn of the wheel moves p periods on.
+            while ((period + p) <= periodCount) {
+                for (c = 0U; c < W::count; ++c) {
+                    notPrime[period * W::periodBytes + byte[c]] |= mask[c];
+                    QIMCIFA_STAT(++writes);
+                    period += q * tables.gap[c] + carry[c];
+                }
+            }
+
+            for (c = 0U; period < periodCount; ++c) {
+                notPrime[period * W::periodBytes + byte[c]] |= mask[c];
+                QIMCIFA_STAT(++writes);
+                period += q * tables.gap[c] + carry[c];
+            }
+            // (The last of these steps might have finished the turn.)
+            if (c == W::count) {
+                c = 0U;
+            }
+        }
+
+        next[k].period = period - periodCount;
+        next[k].c = c;
+    }
+    QIMCIFA_STAT(clock.Lap(SIEVE_PHASE_CROSS_OFF));
+
+    if (largeBegin >= sievingCount) {
+        QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_CROSS_OFFS, writes));
+        return;
+    }
+
+    // A large prime hits a segment only a few times, if at all, so it
+    // waits in the bucket of the next segment it hits, rather than being
+    // visited by every segment in between. (A hit past the end of the
+    // window is dropped, or a narrow window far out would hold nearly
+    // every base prime in its buckets.)
+    while ((largeBegin + cursor.largeCount) < sievingCount) {
+        const size_t k = largeBegin + cursor.largeCount;
+        const size_t p = sievingPrimes[k].P();
+        if (((BigInt)p * p) >= fHi) {
+            break;
+        }
+        size_t c;
+        const size_t period = GetFirstMultiple<W>(fLo, p, c);
+        if (period < windowPeriods) {
+            cursor.Push(k, period, c, periods);
+        }
+        ++cursor.largeCount;
+    }
+    QIMCIFA_STAT(clock.Lap(SIEVE_PHASE_SETUP));
+
+    std::vector<BucketHit>& bucket = cursor.buckets[cursor.head];
+    const size_t hitCount = bucket.size();
+    for (size_t i = 0U; i < hitCount; ++i) {
+        const BucketHit hit = bucket[i];
+        const WheelPrime<W>& wp = sievingPrimes[hit.k];
+        const unsigned char* byte = tables.byte[wp.r];
+        const unsigned char* mask = tables.mask[wp.r];
+        const unsigned char* carry = tables.carry[wp.r];
+        size_t period = hit.period;
+        size_t c = hit.c;
+        while (period < periodCount) {
+            notPrime[period * W::periodBytes + byte[c]] |= mask[c];
+            QIMCIFA_STAT(++writes);
+            period += (size_t)wp.q * tables.gap[c] + carry[c];
+            if (++c == W::count) {
+                c = 0U;
+            }
+        }
+        if (period < windowPeriods) {
+            cursor.Push(hit.k, period, c, periods);
+        }
+    }
+    bucket.erase(bucket.begin(), bucket.begin() + hitCount);
+    cursor.head = (cursor.head + 1U) % cursor.buckets.size();
+    QIMCIFA_STAT(clock.Lap(SIEVE_PHASE_CROSS_OFF); AddSieveStat(SIEVE_STAT_CROSS_OFFS, writes));
+}
+
+template <typename BigInt, typename W = Wheel30>
+std::vector<BigInt> SegmentedSieveOfEratosthenes(BigInt n, size_t segmentBytes = 0U, unsigned threads = 1U);
+template <typename BigInt, typename W = Wheel30>
+std::vector<BigInt> SegmentedSieveRange(const BigInt& lo, const BigInt& hi, size_t segmentBytes = 0U, unsigned threads = 1U);
+
+// The base primes, as plain values, kept for the life of the process
+// for the counts by LMO, and the batch primality lookups, so that
+// repeated queries need not sieve them again. (Windows sieve from
+// the smaller tables of WheelPrimeCache instead.)
+// The table only grows, (until cleared,) by sieving just the range
+// past what it already holds.
+class BasePrimeCache {
+protected:
+    // A published table is never changed, so readers just copy
+    // the pointer, and never wait on a thread that is growing it.
+    std::mutex tableLock;
+    std::shared_ptr<const std::vector<size_t>> primes;
+    size_t limit;
+    // Growth is one thread at a time. (It takes the lock again
+    // when it needs more base primes to sieve its own range.)
+    std::recursive_mutex growLock;
+
+    std::shared_ptr<const std::vector<size_t>> Load(size_t& l)
+    {
+        std::lock_guard<std::mutex> lock(tableLock);
+        l = limit;
+        return primes;
+    }
+
+    void Store(std::shared_ptr<const std::vector<size_t>> table, const size_t& l)
+    {
+        std::lock_guard<std::mutex> lock(tableLock);
+        primes = table;
+        limit = l;
+    }
+
+public:
+    BasePrimeCache()
+        : primes(std::make_shared<const std::vector<size_t>>())
+        , limit(0U)
+    {
+        // Intentionally left blank
+    }
+
+    // Returns the table as it stands, of every prime up to l, in order.
+    std::shared_ptr<const std::vector<size_t>> Snapshot(size_t& l) { return Load(l); }
+
+    // Returns every prime up to n, in order, (and perhaps some past n).
+    std::shared_ptr<const std::vector<size_t>> Get(const size_t& n)
+    {
+        size_t l;
+        std::shared_ptr<const std::vector<size_t>> table = Load(l);
+        if (l >= n) {
+            return table;
+        }
+
+        std::lock_guard<std::recursive_mutex> grow(growLock);
+        table = Load(l);
+        if (l >= n) {
+            return table;
+        }
+
+        // Growing by half again, at least, keeps a rising run of
+        // bounds from copying the whole table on every call.
+        const size_t m = std::max(std::max(n, l + (l >> 1U)), (size_t)65536U);
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_BASE_PRIMES));
+        const std::shared_ptr<std::vector<size_t>> grown = std::make_shared<std::vector<size_t>>();
+        {
+            QIMCIFA_STAT(const PausedSieveStats pause);
+            if (!l) {
+                *grown = SegmentedSieveOfEratosthenes<size_t>(m);
+            } else {
+                const std::vector<size_t> more = SegmentedSieveRange<size_t>(l + 1U, m + 1U);
+                grown->reserve(table->size() + more.size());
+                grown->insert(grown->end(), table->begin(), table->end());
+                grown->insert(grown->end(), more.begin(), more.end());
+            }
+        }
+        QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_BYTES_ALLOCATED, grown->capacity() * sizeof(size_t)));
+        Store(grown, m);
+
+        return grown;
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::recursive_mutex> grow(growLock);
+        Store(std::make_shared<const std::vector<size_t>>(), 0U);
+    }
+};
+
+inline BasePrimeCache& GetBasePrimeCache()
+{
+    static BasePrimeCache cache;
+    return cache;
+}
+
+
+// The base primes past those of wheel W, each with its place on the
+// wheel, kept for the life of the process and shared by every window
+// of W. The table sieves its own growth, a bounded range at a time, so
+// that no wider copy of the primes is ever held beside it.
+template <typename W> class WheelPrimeCache {
+protected:
+    std::mutex tableLock;
+    std::shared_ptr<const std::vector<WheelPrime<W>>> primes;
+    size_t limit;
+    // Growth is one thread at a time. (It takes the lock again, when
+    // the windows that it sieves ask for their own base primes.)
+    std::recursive_mutex growLock;
+
+    // The table is started by the plain sieve up to here, past the
+    // base primes of any window, (so growth never needs more of its own).
+    static constexpr size_t seedLimit = 131072U;
+    // Growth sieves this many integers at a time.
+    static constexpr size_t growthSpan = 1ULL << 26U;
+
+    std::shared_ptr<const std::vector<WheelPrime<W>>> Load(size_t& l)
+    {
+        std::lock_guard<std::mutex> lock(tableLock);
+        l = limit;
+        return primes;
+    }
+
+    void Store(std::shared_ptr<const std::vector<WheelPrime<W>>> table, const size_t& l)
+    {
+        std::lock_guard<std::mutex> lock(tableLock);
+        primes = table;
+        limit = l;
+    }
+
+    // Places the primes of "found" past those of the wheel.
+    static void Place(const std::vector<size_t>& found, std::vector<WheelPrime<W>>& table)
+    {
+        for (const size_t& p : found) {
+            if (W::modulus % p) {
+                table.emplace_back(p);
+            }
+        }
+    }
+
+public:
+    WheelPrimeCache()
+        : primes(std::make_shared<const std::vector<WheelPrime<W>>>())
+        , limit(0U)
+    {
+        // Intentionally left blank
+    }
+
+    // Returns every sieving prime up to n, in order, (and perhaps some
+    // past n). n must be no more than maxSieveRoot.
+    std::shared_ptr<const std::vector<WheelPrime<W>>> Get(const size_t& n)
+    {
+        size_t l;
+        std::shared_ptr<const std::vector<WheelPrime<W>>> table = Load(l);
+        if (l >= n) {
+            return table;
+        }
+
+        std::lock_guard<std::recursive_mutex> grow(growLock);
+        table = Load(l);
+        if (l >= n) {
+            return table;
+        }
+
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_BASE_PRIMES));
+        if (!l) {
+            const std::shared_ptr<std::vector<WheelPrime<W>>> seed = std::make_shared<std::vector<WheelPrime<W>>>();
+            {
+                QIMCIFA_STAT(const PausedSieveStats pause);
+                Place(SieveOfEratosthenes(seedLimit), *seed);
+            }
+            QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_BYTES_ALLOCATED, seed->capacity() * sizeof(WheelPrime<W>)));
+            Store(seed, seedLimit);
+            table = seed;
+            l = seedLimit;
+            if (l >= n) {
+                return table;
+            }
+        }
+
+        // Growing by half again, at least, keeps a rising run of
+        // bounds from copying the whole table on every call.
+        const size_t m = std::min(std::max(n, l + (l >> 1U)), (size_t)maxSieveRoot);
+        const std::shared_ptr<std::vector<WheelPrime<W>>> grown = std::make_shared<std::vector<WheelPrime<W>>>();
+        // pi(x) < x / (ln(x) - 1.1), from x = 60184 on, (by Dusart).
+        grown->reserve((size_t)((double)m / (std::log((double)m) - 1.1)));
+        grown->insert(grown->end(), table->begin(), table->end());
+        {
+            QIMCIFA_STAT(const PausedSieveStats pause);
+            for (size_t lo = l + 1U; lo <= m; lo += growthSpan) {
+                Place(SegmentedSieveRange<size_t, W>(lo, std::min(lo + growthSpan, m + 1U)), *grown);
+            }
+        }
+        QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_BYTES_ALLOCATED, grown->capacity() * sizeof(WheelPrime<W>)));
+        Store(grown, m);
+
+        return grown;
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::recursive_mutex> grow(growLock);
+        Store(std::make_shared<const std::vector<WheelPrime<W>>>(), 0U);
+    }
+};
+
+template <typename W> inline WheelPrimeCache<W>& GetWheelPrimeCache()
+{
+    static WheelPrimeCache<W> cache;
+    return cache;
+}
+
+// Fills the default wheel's table with every base prime needed to
+// sieve up to n, (as far as a window can go).
+template <typename BigInt> void WarmUpBasePrimes(const BigInt& n)
+{
+    const BigInt root = qimcifa::sqrt(n) + 1U;
+    GetWheelPrimeCache<Wheel30>().Get((root < (BigInt)maxSieveRoot) ? (size_t)root : (size_t)maxSieveRoot);
+}
+
+inline void ClearBasePrimes()
+{
+    GetBasePrimeCache().Clear();
+    GetWheelPrimeCache<Wheel30>().Clear();
+    GetWheelPrimeCache<Wheel210>().Clear();
+}
+
+// Thrown out of the segment loop of a sieve whose monitor is cancelled
+class SieveCancelled : public std::runtime_error {
+public:
+    SieveCancelled()
+        : std::runtime_error("The sieve was cancelled.")
+    {
+        // Intentionally left blank
+    }
+};
+
+// Follows every segmented sieve begun, on one thread, in the scope of a
+// ScopedSieveMonitor, so that other threads can read its progress, or
+// cancel it, as of its last segment boundary. Progress counts segments,
+// over every window that the call has opened so far, (the base primes'
+// included,) so it can step back a little when a new one opens.
+class SieveMonitor {
+protected:
+    std::atomic<bool> isCancelled;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> done;
+
+public:
+    SieveMonitor()
+        : isCancelled(false)
+        , total(0U)
+        , done(0U)
+    {
+        // Intentionally left blank
+    }
+
+    void Cancel() { isCancelled = true; }
+
+    bool IsCancelled() const { return isCancelled; }
+
+    void AddSegments(const uint64_t& count) { total += count; }
+
+    // Called before each segment; throws SieveCancelled, once cancelled.
+    void Check() const
+    {
+        if (isCancelled) {
+            throw SieveCancelled();
+        }
+    }
+
+    // Called after each segment
+    void Step() { ++done; }
+
+    // The fraction of the known segments that are done, in [0, 1]
+    double GetProgress() const
+    {
+        const uint64_t t = total;
+        return t ? std::min(1.0, (double)done / (double)t) : 0.0;
+    }
+};
+
+// The monitor of the calling thread, if any
+inline SieveMonitor*& CurrentSieveMonitor()
+{
+    thread_local SieveMonitor* monitor = nullptr;
+    return monitor;
+}
+
+// Puts every segmented sieve that this thread begins, while in scope,
+// under "monitor," which must outlive all of them.
+class ScopedSieveMonitor {
+protected:
+    SieveMonitor* previous;
+
+public:
+    ScopedSieveMonitor(SieveMonitor* monitor)
+        : previous(CurrentSieveMonitor())
+    {
+        CurrentSieveMonitor() = monitor;
+    }
+
+    ~ScopedSieveMonitor() { CurrentSieveMonitor() = previous; }
+};
+
+// The candidates of wheel W in [lo, hi), as 0-indexed bit offsets from
+// the multiple of W at or below lo, split into segments of "span" bits,
+// with every base prime up to sqrt(hi) needed to sieve any of them.
+template <typename BigInt, typename W = Wheel30> struct SieveWindow {
+    // The primes of the wheel (2, 3, 5, and maybe 7) that fall in the window
+    std::vector<BigInt> wheelPrimes;
+    // The base primes past those of the wheel, up to sqrt(hi), as the
+    // first sievingCount of this table, (shared with every other window)
+    std::shared_ptr<const std::vector<WheelPrime<W>>> sievingPrimes;
+    size_t sievingCount;
+    // sievingPrimes from this one on are sieved from buckets.
+    size_t largeBegin;
+    // The ring of buckets spans the furthest step of any large prime.
+    size_t bucketCount;
+    BigInt base;
+    size_t segmentBytes;
+    // Whole periods of the wheel per segment
+    size_t periods;
+    size_t span;
+    size_t begin;
+    size_t end;
+    size_t segmentCount;
+    // (of the thread that opened the window)
+    SieveMonitor* monitor;
+
+    SieveWindow(const BigInt& lo, const BigInt& hi, size_t bytes)
+        : sievingPrimes(std::make_shared<const std::vector<WheelPrime<W>>>())
+        , sievingCount(0U)
+        , largeBegin(0U)
+        , bucketCount(1U)
+        , base(0U)
+        , segmentBytes(NormalizeSegmentBytes(bytes))
+        , periods(segmentBytes / W::periodBytes)
+        , span(periods * W::count)
+        , begin(0U)
+        , end(0U)
+        , segmentCount(0U)
+        , monitor(CurrentSieveMonitor())
+    {
+        if (hi <= lo) {
+            return;
+        }
+        for (const unsigned p : { 2U, 3U, 5U, 7U }) {
+            if (!(W::modulus % p) && (lo <= p) && (p < hi)) {
+                wheelPrimes.push_back(p);
+            }
+        }
+
+        // Divide the window in different segments, from the
+        // multiple of W at or below lo. (Offsets are 0-indexed,
+        // as in the bit set, and 1 is not a candidate.)
+        base = (lo / W::modulus) * W::modulus;
+        begin = std::max(GetCandidateOffset<W>(base, lo), (size_t)(base ? 0U : 1U));
+        end = GetCandidateOffset<W>(base, hi);
+        if (begin >= end) {
+            return;
+        }
+        segmentCount = (end + span - 1U) / span;
+        if (monitor) {
+            monitor->AddSegments(segmentCount);
+        }
+
+        // Once we know every prime up to sqrt(hi), each segment is
+        // independent of every other, so they can run in parallel.
+        // (The last value of a window that ends by 2^64 fits a word, and
+        // then its root, plus 1, is at most maxSieveRoot.)
+        if ((BigInt)(hi - 1U) > (BigInt)(~(uint64_t)0U)) {
+            throw std::overflow_error("A window must end by 2^64, for its base primes to fit in 32 bits.");
+        }
+        const size_t root = (size_t)(qimcifa::sqrt(hi) + 1U);
+        sievingPrimes = GetWheelPrimeCache<W>().Get(root);
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_SETUP));
+        const auto isBelow = [](const WheelPrime<W>& wp, const size_t& v) { return wp.P() < v; };
+        sievingCount = std::distance(sievingPrimes->begin(), std::lower_bound(sievingPrimes->begin(), sievingPrimes->end(), root + 1U, isBelow));
+
+        // From p == periods * W::count on, one whole turn of the wheel
+        // (of W::count hits) spans W::count segments or more, so a prime
+        // hits a segment once at most, on average, (and usually never).
+        largeBegin = std::distance(sievingPrimes->begin(),
+            std::lower_bound(sievingPrimes->begin(), sievingPrimes->begin() + sievingCount, periods * W::count, isBelow));
+        if (largeBegin < sievingCount) {
+            const size_t maxGap = *std::max_element(wheelTables<W>.gap, wheelTables<W>.gap + W::count);
+            const size_t maxStep = ((*sievingPrimes)[sievingCount - 1U].P() * maxGap) / W::modulus + 1U;
+            bucketCount = maxStep / periods + 2U;
+        }
+        QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_BASE_PRIMES, W::primeCount + sievingCount));
+    }
+
+    // Sieves segment "s" into notPrime, and returns the value at bit 0.
+    // Bits [first, last) of notPrime then fall within the window. The
+    // cursor belongs to the calling thread, and carries its sieve on
+    // from segment s - 1, if that was the last one it sieved.
+    BigInt Sieve(const size_t& s, unsigned char* notPrime, size_t& first, size_t& last, SieveCursor& cursor) const
+    {
+        const size_t low = s * span;
+        const size_t high = std::min(low + span, end);
+        const BigInt fLo = base + (BigInt)(s * periods * W::modulus);
+
+        if (monitor) {
+            monitor->Check();
+        }
+        if (cursor.segment != s) {
+            cursor.Reset(bucketCount);
+        }
+        SieveSegment<W>(notPrime, fLo, high - low, periods, (end - low + W::count - 1U) / W::count, *sievingPrimes,
+            sievingCount, largeBegin, cursor);
+        cursor.segment = s + 1U;
+        if (monitor) {
+            monitor->Step();
+        }
+        QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_SEGMENTS, 1U));
+
+        first = std::max(begin, low) - low;
+        last = high - low;
+
+        return fLo;
+    }
+};
+
+// Returns the primes in [lo, hi), in order, by sieving just that window
+// (and the base primes up to sqrt(hi)), rather than everything below lo.
+template <typename BigInt, typename W>
+std::vector<BigInt> SegmentedSieveRange(const BigInt& lo, const BigInt& hi, size_t segmentBytes, unsigned threads)
+{
+    const SieveWindow<BigInt, W> window(lo, hi, segmentBytes);
+    std::vector<BigInt> knownPrimes = window.wheelPrimes;
+    const size_t segmentCount = window.segmentCount;
+
+    // Every segment fills its own output, so no thread
+    // ever waits on another to append to a shared list.
+    std::vector<std::vector<BigInt>> segmentPrimes(segmentCount);
+    if (!threads) {
+        threads = GetDefaultThreadCount();
+    }
+    std::vector<SieveCursor> cursors(threads);
+    ParallelFor(segmentCount, threads, [&](const size_t& s, const unsigned& cpu) {
+        unsigned char* notPrime = GetSegmentBuffer(window.segmentBytes);
+        size_t first, last;
+        const BigInt fLo = window.Sieve(s, notPrime, first, last, cursors[cpu]);
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_SCAN));
+
+        // Numbers which are not marked are prime
+        std::vector<BigInt>& primes = segmentPrimes[s];
+        ForEachClearBit(notPrime, first, last, [&](const size_t& o) { primes.push_back(fLo + (BigInt)W::Forward(o)); });
+    });
+
+    // A prefix sum of the segment sizes gives each segment's
+    // place in the (sorted) output, to concatenate in parallel.
+    std::vector<size_t> offsets(segmentCount + 1U);
+    offsets[0U] = knownPrimes.size();
+    for (size_t s = 0U; s < segmentCount; ++s) {
+        offsets[s + 1U] = offsets[s] + segmentPrimes[s].size();
+    }
+    knownPrimes.resize(offsets[segmentCount]);
+    ParallelFor(segmentCount, threads, [&](const size_t& s, const unsigned&) {
+        std::move(segmentPrimes[s].begin(), segmentPrimes[s].end(), knownPrimes.begin() + offsets[s]);
+        std::vector<BigInt>().swap(segmentPrimes[s]);
+    });
+
+    return knownPrimes;
+}
+
+template <typename BigInt, typename W>
+std::vector<BigInt> SegmentedSieveOfEratosthenes(BigInt n, size_t segmentBytes, unsigned threads)
+{
+    // Small enough bounds fit in one segment's worth of bytes.
+    if ((NormalizeSegmentBytes(segmentBytes) * 30U) >= n) {
+        return SieveOfEratosthenes(n);
+    }
+
+    return SegmentedSieveRange<BigInt, W>(0U, n + 1U, segmentBytes, threads);
+}
+
+// Yields the primes in [lo, hi) one segment at a time, so that peak
+// memory is one segment and the base primes, however wide the window.
+template <typename BigInt, typename W = Wheel30> class SegmentedSieveIterator {
+protected:
+    SieveWindow<BigInt, W> window;
+    SieveCursor cursor;
+    size_t segment;
+
+public:
+    SegmentedSieveIterator(const BigInt& lo, const BigInt& hi, size_t segmentBytes = 0U)
+        : window(lo, hi, segmentBytes)
+        // The wheel primes come first, as their own "segment" 0.
+        , segment(window.wheelPrimes.empty() ? 1U : 0U)
+    {
+        // Intentionally left blank
+    }
+
+    bool IsDone() const { return segment > window.segmentCount; }
+
+    // Returns the primes of the next segment, in order. (Some
+    // segments might have none, so check IsDone() instead.)
+    std::vector<BigInt> Next()
+    {
+        if (IsDone()) {
+            return std::vector<BigInt>();
+        }
+        if (!segment) {
+            ++segment;
+            return window.wheelPrimes;
+        }
+
+        // Each step answers to the monitor of its own caller, if any,
+        // (as the one at construction might not outlive the iterator).
+        window.monitor = CurrentSieveMonitor();
+        unsigned char* notPrime = GetSegmentBuffer(window.segmentBytes);
+        size_t first, last;
+        const BigInt fLo = window.Sieve(segment - 1U, notPrime, first, last, cursor);
+        ++segment;
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_SCAN));
+
+        std::vector<BigInt> primes;
+        ForEachClearBit(notPrime, first, last, [&](const size_t& o) { primes.push_back(fLo + (BigInt)W::Forward(o)); });
+
+        return primes;
+    }
+};
+
+// Pardon the obvious "copy/pasta."
+// I began to design a single method to switch off between these two,
+// then I realized the execution time overhead of the implementation.
+// (It would compound linearly over the cardinality to check.)
+// It is certainly "cheap" to copy/paste, but that's our only goal.
+
+template <typename BigInt> BigInt CountPrimesTo(const BigInt& n)
+{
+    const BigInt knownPrimes[4U] = { 2U, 3U, 5U, 7U };
+    if (n < 2U) {
+        return 0U;
+    }
+
+    if (n < 11U) {
+        const auto highestPrimeIt = std::upper_bound(knownPrimes, knownPrimes + 4U, n);
+        return std::distance(knownPrimes, highestPrimeIt);
+    }
+
+    // We are excluding multiples of the first few
+    // small primes from outset. For multiples of
+    // 2, 3, and 5 this reduces complexity to 4/15.
+    const size_t cardinality = backward5(n);
+
+    // Create a bit set "prime[0..cardinality)" and
+    // initialize all entries it as true. Rather,
+    // reverse the true/false meaning, so we can use
+    // default initialization. A bit in notPrime[i]
+    // will finally be false only if i is a prime.
+    // (One byte holds the 8 wheel5 residues of 30.)
+    // The multiples of 7 through 19 are presieved.
+    std::unique_ptr<unsigned char[]> uNotPrime(new unsigned char[(cardinality + 7U) >> 3U]);
+    unsigned char* notPrime = uNotPrime.get();
+    Presieve<Wheel30>(notPrime, (BigInt)0U, (cardinality + 7U) >> 3U);
+
+    // Get the remaining prime numbers.
+    // These wheel initializations are simply correct and optimal.
+    // The integral form is rather a distinguishable bit set form.
+    unsigned short wheel5 = 129U;
+    unsigned long long wheel7 = 9009416540524545ULL;
+    size_t o = 1U;
+    BigInt count = 4U;
+    for (;;) {
+        o += GetWheel5and7Increment(wheel5, wheel7);
+
+        const BigInt p = forward3<BigInt>(o);
+        if ((p * p) > n) {
+            break;
+        }
+
+        if (IsBitSet(notPrime, backward5(p) - 1U)) {
+            continue;
+        }
+
+        ++count;
+        if (p <= 19U) {
+            continue;
+        }
+
+        // We are skipping multiples of 2, 3, and 5
+        // for space complexity, for 4/15 the bits.
+        // More are skipped by the wheel for time.
+        const BigInt p2 = p << 1U;
+        const BigInt p4 = p << 2U;
+        BigInt i = p * p;
+
+        // "p" already definitely not a multiple of 3.
+        // Its remainder when divided by 3 can be 1 or 2.
+        // If it is 2, we can do a "half iteration" of the
+        // loop that would handle remainder of 1, and then
+        // we can proceed with the 1 remainder loop.
+        // This saves 2/3 of updates (or modulo).
+        if ((p % 3U) == 2U) {
+            SetBit(notPrime, backward5(i) - 1U);
+            i += p2;
+            if (i > n) {
+                continue;
+            }
+        }
+
+        for (;;) {
+            if (i % 5U) {
+                SetBit(notPrime, backward5(i) - 1U);
+            }
+            i += p4;
+            if (i > n) {
+                break;
+            }
+
+            if (i % 5U) {
+                SetBit(notPrime, backward5(i) - 1U);
+            }
+            i += p2;
+            if (i > n) {
+                break;
+            }
+        }
+    }
+
+    // Past the square root, every clear bit up to n is a prime.
+    // (The multiples of 7 were presieved, so they need no skipping.)
+    count += CountClearBits(notPrime, backward5(forward3<BigInt>(o)) - 1U, GetCandidateOffset<Wheel30>((BigInt)0U, (BigInt)(n + 1U)));
+
+    return count;
+}
+
+// Counts the primes in [lo, hi), by sieving just that window
+// (and the base primes up to sqrt(hi)), rather than everything below lo.
+template <typename BigInt, typename W = Wheel30>
+BigInt SegmentedCountRange(const BigInt& lo, const BigInt& hi, size_t segmentBytes = 0U, unsigned threads = 1U)
+{
+    const SieveWindow<BigInt, W> window(lo, hi, segmentBytes);
+    BigInt count = window.wheelPrimes.size();
+
+    if (!threads) {
+        threads = GetDefaultThreadCount();
+    }
+    std::vector<size_t> counts(threads, 0U);
+    std::vector<SieveCursor> cursors(threads);
+
+    ParallelFor(window.segmentCount, threads, [&](const size_t& s, const unsigned& cpu) {
+        unsigned char* notPrime = GetSegmentBuffer(window.segmentBytes);
+        size_t first, last;
+        window.Sieve(s, notPrime, first, last, cursors[cpu]);
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_SCAN));
+
+        counts[cpu] += CountClearBits(notPrime, first, last);
+    });
+
+    for (const size_t& c : counts) {
+        count += c;
+    }
+
+    return count;
+}
+
+template <typename BigInt, typename W = Wheel30>
+BigInt SegmentedCountPrimesTo(BigInt n, size_t segmentBytes = 0U, unsigned threads = 1U)
+{
+    // Small enough bounds fit in one segment's worth of bytes.
+    if ((NormalizeSegmentBytes(segmentBytes) * 30U) >= n) {
+        return CountPrimesTo(n);
+    }
+
+    return SegmentedCountRange<BigInt, W>(0U, n + 1U, segmentBytes, threads);
+}
+} // namespace qimcifa
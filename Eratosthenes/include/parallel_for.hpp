@@ -0,0 +1,156 @@
+// A small work-stealing scheduler for independent sieve segments.
+//
+// Each thread starts with an equal, contiguous run of segment indices,
+// and it takes its own segments in ascending order. When a thread runs
+// dry, it steals the upper half of the longest remaining run. Threads
+// therefore mostly visit consecutive segments, which lets the engines
+// carry per-thread sieving state from one segment to the next.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qimcifa {
+
+// Returns the number of threads to use, when the caller asks for 0.
+inline unsigned GetDefaultThreadCount()
+{
+    const unsigned threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1U;
+}
+
+// Calls fn(i, cpu) exactly once for every i in [0, count),
+// over up to "threads" workers, where "cpu" is the index of
+// the calling worker in [0, threads). Any exception thrown
+// by fn() stops the remaining work and is rethrown here.
+template <typename Fn> void ParallelFor(const size_t& count, unsigned threads, Fn fn)
+{
+    if (!threads) {
+        threads = GetDefaultThreadCount();
+    }
+    if (threads > count) {
+        threads = (unsigned)count;
+    }
+    if (threads <= 1U) {
+        for (size_t i = 0U; i < count; ++i) {
+            fn(i, 0U);
+        }
+        return;
+    }
+
+    struct alignas(64) StealRange {
+        std::mutex lock;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<StealRange> ranges(threads);
+    for (unsigned cpu = 0U; cpu < threads; ++cpu) {
+        ranges[cpu].begin = (count * cpu) / threads;
+        ranges[cpu].end = (count * (cpu + 1U)) / threads;
+    }
+
+    std::mutex errorLock;
+    std::exception_ptr error;
+    std::atomic<bool> isFailed(false);
+
+    auto worker = [&](const unsigned cpu) {
+        StealRange& own = ranges[cpu];
+        for (;;) {
+            if (isFailed) {
+                return;
+            }
+
+            size_t i;
+            bool isFound = false;
+            {
+                std::lock_guard<std::mutex> lock(own.lock);
+                if (own.begin < own.end) {
+                    i = own.begin++;
+                    isFound = true;
+                }
+            }
+
+            if (!isFound) {
+                // Steal the upper half of the longest remaining run.
+                size_t stolenBegin = 0U, stolenEnd = 0U;
+                for (;;) {
+                    unsigned victim = cpu;
+                    size_t longest = 0U;
+                    for (unsigned v = 0U; v < threads; ++v) {
+                        if (v == cpu) {
+                            continue;
+                        }
+                        std::lock_guard<std::mutex> lock(ranges[v].lock);
+                        if ((ranges[v].end - ranges[v].begin) > longest) {
+                            longest = ranges[v].end - ranges[v].begin;
+                            victim = v;
+                        }
+                    }
+                    if (!longest) {
+                        return;
+                    }
+
+                    std::lock_guard<std::mutex> lock(ranges[victim].lock);
+                    StealRange& v = ranges[victim];
+                    if (v.begin >= v.end) {
+                        // Someone else got there first.
+                        continue;
+                    }
+                    stolenBegin = v.begin + ((v.end - v.begin) >> 1U);
+                    stolenEnd = v.end;
+                    v.end = stolenBegin;
+                    break;
+                }
+
+                std::lock_guard<std::mutex> lock(own.lock);
+                i = stolenBegin;
+                own.begin = stolenBegin + 1U;
+                own.end = stolenEnd;
+            }
+
+            try {
+                fn(i, cpu);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorLock);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                isFailed = true;
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1U);
+    for (unsigned cpu = 1U; cpu < threads; ++cpu) {
+        workers.emplace_back(worker, cpu);
+    }
+    worker(0U);
+    for (std::thread& t : workers) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Calls fn(i) exactly once for every i in [0, count), in runs of
+// "grain" consecutive indices, over up to "threads" workers.
+template <typename Fn> void ParallelForEach(const size_t& count, const size_t& grain, unsigned threads, Fn fn)
+{
+    ParallelFor((count + grain - 1U) / grain, threads, [&](const size_t& run, const unsigned&) {
+        const size_t end = std::min(count, (run + 1U) * grain);
+        for (size_t i = run * grain; i < end; ++i) {
+            fn(i);
+        }
+    });
+}
+} // namespace qimcifa
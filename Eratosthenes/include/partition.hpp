@@ -0,0 +1,141 @@
+// Splitting one range of the segmented sieve over many machines.
+//
+// PartitionRange() cuts [lo, hi) into chunks of about equal expected
+// work, at multiples of the span of one segment, so that every chunk
+// sieves exactly the segments that one run from 0 would.
+// Each chunk reduces to a RangeSummary, (its count, and its first and
+// last primes and widest gap, for the gaps that cross between chunks,)
+// and the summaries of adjacent chunks merge, in order, into the one of
+// their union.
+
+#pragma once
+
+#include "prime_reduce.hpp"
+
+#include <cmath>
+
+namespace qimcifa {
+
+template <typename BigInt> struct RangeSummary {
+    BigInt count;
+    // The first and last primes, and the widest gap between them
+    typename PrimeMaxGapOp<BigInt>::Partial gaps;
+
+    RangeSummary()
+        : count(0U)
+    {
+        // Intentionally left blank
+    }
+};
+
+// Counts the primes, and follows their gaps, in one pass per segment.
+template <typename BigInt> struct PrimeSummaryOp {
+    typedef RangeSummary<BigInt> Partial;
+    static constexpr bool isOrdered = true;
+    PrimeMaxGapOp<BigInt> gapOp;
+
+    Partial Identity() const { return Partial(); }
+
+    void Add(Partial& part, const BigInt& p) const
+    {
+        ++part.count;
+        gapOp.Add(part.gaps, p);
+    }
+
+    template <typename W>
+    void Fold(Partial& part, const unsigned char* bits, const size_t& first, const size_t& last, const BigInt& fLo) const
+    {
+        part.count += CountClearBits(bits, first, last);
+        gapOp.template Fold<W>(part.gaps, bits, first, last, fLo);
+    }
+
+    void Merge(Partial& part, const Partial& next) const
+    {
+        part.count += next.count;
+        gapOp.Merge(part.gaps, next.gaps);
+    }
+};
+
+template <typename BigInt, typename W = Wheel30>
+RangeSummary<BigInt> SummarizeRange(const BigInt& lo, const BigInt& hi, size_t segmentBytes = 0U, unsigned threads = 1U)
+{
+    return SegmentedReduceRange<BigInt, W>(lo, hi, PrimeSummaryOp<BigInt>(), segmentBytes, threads);
+}
+
+// Summarizes primes already in hand, in order.
+template <typename BigInt> RangeSummary<BigInt> SummarizePrimes(const std::vector<BigInt>& primes)
+{
+    const PrimeSummaryOp<BigInt> op;
+    RangeSummary<BigInt> summary;
+    for (const BigInt& p : primes) {
+        op.Add(summary, p);
+    }
+
+    return summary;
+}
+
+// The values that one segment of wheel W spans, for a requested size
+template <typename W> inline size_t GetSegmentValues(const size_t& segmentBytes)
+{
+    return (NormalizeSegmentBytes(segmentBytes) / W::periodBytes) * W::modulus;
+}
+
+// The expected time to sieve about t, per value, relative to small t.
+// Past about 10^13, stepping every base prime up to sqrt(t) through
+// each segment, (whether or not it hits,) comes to dominate, and grows
+// with the count of base primes per value of the segment.
+inline double EstimateSieveWork(const double& t, const double& segmentValues)
+{
+    const double root = std::sqrt(t);
+    const double basePrimes = (root < 3.0) ? 0.0 : (root / std::log(root));
+
+    return 1.0 + 25.0 * basePrimes / segmentValues;
+}
+
+// Returns the bounds of up to "parts" chunks of [lo, hi), in order, from
+// lo through hi, with every bound in between a multiple of the span of a
+// segment. (Ranges of fewer segments than parts get fewer chunks.)
+template <typename BigInt, typename W = Wheel30>
+std::vector<BigInt> PartitionRange(const BigInt& lo, const BigInt& hi, size_t parts, size_t segmentBytes = 0U)
+{
+    std::vector<BigInt> bounds{ lo };
+    if (hi <= lo) {
+        return bounds;
+    }
+    if (!parts) {
+        parts = 1U;
+    }
+
+    // The expected work up to each of "steps" even steps across the range
+    const size_t steps = 4096U;
+    const double segmentValues = (double)GetSegmentValues<W>(segmentBytes);
+    const double dLo = (double)lo;
+    const double width = (double)(hi - lo);
+    std::vector<double> work(steps + 1U, 0.0);
+    double prior = EstimateSieveWork(dLo, segmentValues);
+    for (size_t k = 1U; k <= steps; ++k) {
+        const double next = EstimateSieveWork(dLo + width * k / steps, segmentValues);
+        work[k] = work[k - 1U] + (prior + next) / 2.0;
+        prior = next;
+    }
+
+    const BigInt segment = (BigInt)GetSegmentValues<W>(segmentBytes);
+    size_t k = 0U;
+    for (size_t i = 1U; i < parts; ++i) {
+        const double target = work[steps] * i / parts;
+        while (work[k + 1U] < target) {
+            ++k;
+        }
+        const double x = dLo + width * (k + (target - work[k]) / (work[k + 1U] - work[k])) / steps;
+
+        // Round to the nearest segment boundary.
+        const BigInt bound = (BigInt)BigInteger(std::floor(x / (double)segment + 0.5)) * segment;
+        if ((bound > bounds.back()) && (bound < hi)) {
+            bounds.push_back(bound);
+        }
+    }
+    bounds.push_back(hi);
+
+    return bounds;
+}
+} // namespace qimcifa
@@ -0,0 +1,255 @@
+// Primality tests of single numbers, and the nearest primes to them.
+//
+// Native words take a Miller-Rabin test that is deterministic for every
+// 64-bit input, (by the bases of J. Sinclair,) in Montgomery form where
+// the compiler has a 128-bit product. Anything wider takes Boost's own
+// Miller-Rabin test, which is probabilistic. The batch forms answer any
+// value within the base-prime cache (see BasePrimeCache) straight from
+// it, and split the rest over threads.
+
+#pragma once
+
+#include "eratosthenes.hpp"
+
+#include <limits>
+
+#include <boost/multiprecision/miller_rabin.hpp>
+#include <boost/random/mersenne_twister.hpp>
+
+namespace qimcifa {
+
+// Trial division by these primes settles most composites before any
+// modular exponentiation, and all n below 67 * 67.
+inline constexpr unsigned char trialPrimes[18U] = { 2U, 3U, 5U, 7U, 11U, 13U, 17U, 19U, 23U, 29U, 31U, 37U, 41U, 43U, 47U,
+    53U, 59U, 61U };
+
+#if defined(__SIZEOF_INT128__)
+// Arithmetic modulo odd n, in Montgomery form, (i.e., x stands for x * 2^64 mod n).
+struct ModArithmetic64 {
+    uint64_t n;
+    // n^-1 mod 2^64
+    uint64_t inverse;
+    // 2^128 mod n
+    uint64_t r2;
+    uint64_t one;
+
+    ModArithmetic64(const uint64_t& m)
+        : n(m)
+        , inverse(m)
+    {
+        // Each Newton step doubles the correct low bits, from 3 (as n * n == 1 mod 8).
+        for (size_t i = 0U; i < 5U; ++i) {
+            inverse *= 2U - m * inverse;
+        }
+        one = (0U - m) % m;
+        r2 = (uint64_t)(((unsigned __int128)one * one) % m);
+    }
+
+    uint64_t Reduce(const unsigned __int128& t) const
+    {
+        // t - (t * n^-1 mod 2^64) * n is a multiple of 2^64, so its low words cancel.
+        const uint64_t mn = (uint64_t)(((unsigned __int128)((uint64_t)t * inverse) * n) >> 64U);
+        const uint64_t hi = (uint64_t)(t >> 64U);
+
+        return (hi >= mn) ? (hi - mn) : (hi - mn + n);
+    }
+
+    uint64_t To(const uint64_t& x) const { return Mul(x % n, r2); }
+
+    uint64_t Mul(const uint64_t& a, const uint64_t& b) const { return Reduce((unsigned __int128)a * b); }
+};
+#else
+// Arithmetic modulo n, by doubling and adding, for want of a 128-bit product.
+struct ModArithmetic64 {
+    uint64_t n;
+    uint64_t one;
+
+    ModArithmetic64(const uint64_t& m)
+        : n(m)
+        , one(1U % m)
+    {
+        // Intentionally left blank
+    }
+
+    uint64_t To(const uint64_t& x) const { return x % n; }
+
+    uint64_t Mul(uint64_t a, uint64_t b) const
+    {
+        uint64_t r = 0U;
+        for (; b; b >>= 1U) {
+            if (b & 1U) {
+                r = (r >= (n - a)) ? (r - (n - a)) : (r + a);
+            }
+            a = (a >= (n - a)) ? (a - (n - a)) : (a + a);
+        }
+
+        return r;
+    }
+};
+#endif
+
+// Is odd n > 2 a strong probable prime to each of "bases"?
+template <size_t Count> inline bool MillerRabin(const uint64_t& n, const uint64_t (&bases)[Count])
+{
+    const ModArithmetic64 mod(n);
+    const uint64_t minusOne = n - mod.one;
+    uint64_t d = n - 1U;
+    const unsigned s = CountTrailingZeros(d);
+    d >>= s;
+
+    for (const uint64_t& a : bases) {
+        uint64_t x = mod.To(a);
+        if (!x) {
+            continue;
+        }
+
+        uint64_t y = mod.one;
+        for (uint64_t e = d; e; e >>= 1U) {
+            if (e & 1U) {
+                y = mod.Mul(y, x);
+            }
+            x = mod.Mul(x, x);
+        }
+        if ((y == mod.one) || (y == minusOne)) {
+            continue;
+        }
+
+        bool isWitness = true;
+        for (unsigned r = 1U; r < s; ++r) {
+            y = mod.Mul(y, y);
+            if (y == minusOne) {
+                isWitness = false;
+                break;
+            }
+        }
+        if (isWitness) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline bool IsPrime(const uint64_t& n)
+{
+    if (n < 2U) {
+        return false;
+    }
+    for (const unsigned char& p : trialPrimes) {
+        if (!(n % p)) {
+            return n == p;
+        }
+    }
+    if (n < (67U * 67U)) {
+        return true;
+    }
+
+    if (n < 3215031751ULL) {
+        constexpr uint64_t bases[4U] = { 2U, 3U, 5U, 7U };
+        return MillerRabin(n, bases);
+    }
+    constexpr uint64_t bases[7U] = { 2U, 325U, 9375U, 28178U, 450775U, 9780504U, 1795265022U };
+
+    return MillerRabin(n, bases);
+}
+
+inline bool IsPrime(const BigInteger& n)
+{
+    if (n <= std::numeric_limits<uint64_t>::max()) {
+        return (n >= 2U) && IsPrime((uint64_t)n);
+    }
+
+    // (Boost's own overload shares one engine between all threads.)
+    thread_local boost::random::mt19937 gen;
+    return boost::multiprecision::miller_rabin_test(n, 25U, gen);
+}
+
+// Returns the least prime greater than n.
+template <typename BigInt> BigInt NextPrime(const BigInt& n)
+{
+    for (const unsigned p : { 2U, 3U, 5U }) {
+        if (n < p) {
+            return p;
+        }
+    }
+
+    // Try each candidate of wheel 30 past n, in turn.
+    const BigInt base = (n / 30U) * 30U;
+    for (size_t o = GetCandidateOffset<Wheel30>(base, (BigInt)(n + 1U));; ++o) {
+        const BigInt c = base + (BigInt)Wheel30::Forward(o);
+        if (IsPrime(c)) {
+            return c;
+        }
+    }
+}
+
+// Returns the greatest prime less than n, or 0 if there is none.
+template <typename BigInt> BigInt PrevPrime(const BigInt& n)
+{
+    if (n <= 7U) {
+        return (n > 5U) ? 5U : (n > 3U) ? 3U : (n > 2U) ? 2U : 0U;
+    }
+
+    // Try each candidate of wheel 30 below n, in turn, (and 7 is one).
+    BigInt base = (n / 30U) * 30U;
+    size_t o = GetCandidateOffset<Wheel30>(base, n);
+    for (;;) {
+        if (!o) {
+            base -= 30U;
+            o = Wheel30::count;
+        }
+        --o;
+        const BigInt c = base + (BigInt)Wheel30::Forward(o);
+        if (IsPrime(c)) {
+            return c;
+        }
+    }
+}
+
+// Returns fn(x, known, limit) for every x of xs, over "threads" threads,
+// (0 for all,) where "known" holds every prime up to "limit," in order,
+// from the base-prime cache as it stands.
+template <typename R, typename BigInt, typename Fn>
+std::vector<R> MapPrimeQueries(const std::vector<BigInt>& xs, unsigned threads, Fn fn)
+{
+    size_t limit;
+    const std::shared_ptr<const std::vector<size_t>> known = GetBasePrimeCache().Snapshot(limit);
+    std::vector<R> out(xs.size());
+    ParallelForEach(xs.size(), 4096U, threads, [&](const size_t& i) { out[i] = fn(xs[i], *known, limit); });
+
+    return out;
+}
+
+// Tests each of xs for primality. (The results are 0 or 1.)
+template <typename BigInt> std::vector<unsigned char> IsPrimeBatch(const std::vector<BigInt>& xs, unsigned threads = 0U)
+{
+    return MapPrimeQueries<unsigned char>(xs, threads, [](const BigInt& x, const std::vector<size_t>& known, const size_t& limit) {
+        if ((x >= 0) && (x <= limit)) {
+            return (unsigned char)std::binary_search(known.begin(), known.end(), (size_t)x);
+        }
+        return (unsigned char)IsPrime(x);
+    });
+}
+
+// Returns the least prime greater than each of xs.
+template <typename BigInt> std::vector<BigInt> NextPrimeBatch(const std::vector<BigInt>& xs, unsigned threads = 0U)
+{
+    return MapPrimeQueries<BigInt>(xs, threads, [](const BigInt& x, const std::vector<size_t>& known, const size_t&) {
+        if ((x >= 0) && !known.empty() && (x < known.back())) {
+            return (BigInt)*std::upper_bound(known.begin(), known.end(), (size_t)x);
+        }
+        return NextPrime(x);
+    });
+}
+
+// Returns the greatest prime less than each of xs, or 0 where there is none.
+template <typename BigInt> std::vector<BigInt> PrevPrimeBatch(const std::vector<BigInt>& xs, unsigned threads = 0U)
+{
+    return MapPrimeQueries<BigInt>(xs, threads, [](const BigInt& x, const std::vector<size_t>& known, const size_t& limit) {
+        if ((x > 2) && (x <= limit)) {
+            return (BigInt)*(std::lower_bound(known.begin(), known.end(), (size_t)x) - 1U);
+        }
+        return PrevPrime(x);
+    });
+}
+} // namespace qimcifa
@@ -0,0 +1,286 @@
+// Counts the primes up to x without visiting each of them, by the method of
+// Lagarias, Miller, and Odlyzko: with y >= cbrt(x) and a = pi(y),
+//
+//     pi(x) = phi(x, a) + a - 1 - P2(x, a),
+//
+// where phi(x, a) counts the integers up to x with no prime factor among
+// the first a primes, and P2(x, a) counts those that are the product of
+// two primes greater than y. Expanding phi(x, a) leaves "ordinary" terms
+// phi(x / n, 0) for squarefree n <= y, which are just x / n, and "special"
+// terms phi(x / n, b) for n > y, all with x / n < x / y, which come from
+// one segmented sieve of [1, x / y]. P2 takes one pass of the ordinary
+// segmented sieve over the same range. Time is about (x / y) * log(x),
+// next to the x * log(log(x)) of sieving everything up to x.
+
+#pragma once
+
+#include "eratosthenes.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace qimcifa {
+
+// Below this bound, sieving up to x is the faster way to count.
+constexpr uint64_t primeCountThreshold = 10000000ULL;
+// Bits of each segment of the sieve for phi, (32 KB of them,) so that
+// the walks of its tree, for every term, stay within the L1 cache.
+constexpr size_t phiSegmentWords = 4096U;
+// The primes of P2 are sieved this many integers at a time.
+constexpr uint64_t lmoChunkSpan = 1ULL << 22U;
+
+// Returns floor(cbrt(n)).
+inline uint64_t cbrt(const uint64_t& n)
+{
+    uint64_t r = (uint64_t)std::cbrt((double)n);
+    while (r && ((r * r * r) > n)) {
+        --r;
+    }
+    while (((r + 1U) * (r + 1U) * (r + 1U)) <= n) {
+        ++r;
+    }
+
+    return r;
+}
+
+// The odd numbers of one segment, [low, low + 2 * bits.size() * 64),
+// with a binary indexed tree over the counts of their 64-bit words, (so
+// that counting the numbers not yet crossed off, up to any v, takes
+// logarithmic time,) for the special terms of phi.
+struct PhiSegment {
+    uint64_t low;
+    std::vector<uint64_t> bits;
+    std::vector<uint32_t> tree;
+    uint64_t count;
+
+    PhiSegment(const size_t& words)
+        : low(1U)
+        , bits(words)
+        , tree(words + 1U)
+        , count(0U)
+    {
+        // Intentionally left blank
+    }
+
+    // Starts the segment at odd "l," with every odd number below "end" in it.
+    void Reset(const uint64_t& l, const uint64_t& end)
+    {
+        low = l;
+        const uint64_t n = (end > low) ? std::min((uint64_t)bits.size() << 6U, (end - low + 1U) >> 1U) : 0U;
+        for (size_t w = 0U; w < bits.size(); ++w) {
+            const uint64_t begin = (uint64_t)w << 6U;
+            bits[w] = (n >= (begin + 64U)) ? ~(uint64_t)0U : (n > begin) ? (((uint64_t)1U << (n - begin)) - 1U) : 0U;
+        }
+        count = n;
+
+        std::fill(tree.begin(), tree.end(), 0U);
+        for (size_t i = 1U; i <= bits.size(); ++i) {
+            tree[i] += PopCountWord(bits[i - 1U]);
+            const size_t j = i + (i & (~i + 1U));
+            if (j <= bits.size()) {
+                tree[j] += tree[i];
+            }
+        }
+    }
+
+    // Crosses off the odd multiples of p in the segment. (Every smaller
+    // prime is already crossed off, so that leaves p and those from p * p.)
+    void CrossOff(const uint64_t& p)
+    {
+        const uint64_t high = low + ((uint64_t)bits.size() << 7U);
+        if ((p >= low) && (p < high)) {
+            Clear((p - low) >> 1U);
+        }
+        uint64_t m = std::max(p * p, ((low + p - 1U) / p) * p);
+        if (!(m & 1U)) {
+            m += p;
+        }
+        for (; m < high; m += p << 1U) {
+            Clear((m - low) >> 1U);
+        }
+    }
+
+    // Crosses off the odd number at bit i, if it is not already.
+    void Clear(const uint64_t& i)
+    {
+        const uint64_t bit = (uint64_t)1U << (i & 63U);
+        uint64_t& word = bits[i >> 6U];
+        if (!(word & bit)) {
+            return;
+        }
+        word ^= bit;
+        --count;
+        for (size_t j = (i >> 6U) + 1U; j <= bits.size(); j += j & (~j + 1U)) {
+            --tree[j];
+        }
+    }
+
+    // Counts the numbers left in [low, v].
+    uint64_t CountTo(const uint64_t& v) const
+    {
+        const uint64_t i = (v - low) >> 1U;
+        uint64_t c = PopCountWord(bits[i >> 6U] & (~(uint64_t)0U >> (63U - (i & 63U))));
+        for (size_t j = i >> 6U; j; j -= j & (~j + 1U)) {
+            c += tree[j];
+        }
+
+        return c;
+    }
+};
+
+// Returns pi(x), for x below 2^62. (Sums run modulo 2^64, as pi(x) fits
+// a word, although the terms that make it up might not, on the way.)
+inline uint64_t CountPrimesLMO(const uint64_t& x)
+{
+    if (x < 1000000U) {
+        return CountPrimesTo(x);
+    }
+
+    // y >= cbrt(x) leaves no product of three primes past y below x.
+    // Raising it trades sieving (of [1, x / y]) for more special terms.
+    const uint64_t root = qimcifa::sqrt(x);
+    const double alpha = std::max(1.0, std::log((double)x) / 6.0);
+    const uint64_t y = std::min(root, std::max(cbrt(x), (uint64_t)(alpha * (double)cbrt(x))));
+    const uint64_t z = x / y;
+
+    // Only the primes up to y are kept, (in the base-prime cache,) as the
+    // many more up to sqrt(x) are only ever needed once, in order, by P2.
+    const std::shared_ptr<const std::vector<size_t>> known = GetBasePrimeCache().Get(y);
+    const std::vector<size_t>& primes = *known;
+    const size_t a = std::distance(primes.begin(), std::upper_bound(primes.begin(), primes.end(), y));
+
+    // The least prime factor and Moebius function of every n up to y
+    QIMCIFA_STAT(SieveStatClock clock);
+    std::vector<uint32_t> lpf(y + 1U, 0U);
+    std::vector<signed char> mu(y + 1U, 1);
+    for (size_t k = 0U; k < a; ++k) {
+        const uint64_t p = primes[k];
+        for (uint64_t m = p; m <= y; m += p) {
+            if (!lpf[m]) {
+                lpf[m] = (uint32_t)p;
+            }
+            mu[m] = -mu[m];
+        }
+        for (uint64_t m = p * p; m <= y; m += p * p) {
+            mu[m] = 0;
+        }
+    }
+    lpf[1U] = ~(uint32_t)0U;
+    QIMCIFA_STAT(clock.Lap(SIEVE_PHASE_SETUP);
+                 AddSieveStat(SIEVE_STAT_BYTES_ALLOCATED, (y + 1U) * (sizeof(uint32_t) + sizeof(signed char))));
+
+    // Ordinary terms, phi(x / n, 0) == x / n
+    uint64_t phi = 0U;
+    for (uint64_t n = 1U; n <= y; ++n) {
+        if (mu[n]) {
+            phi += (mu[n] > 0) ? (x / n) : (0U - (x / n));
+        }
+    }
+
+    // Special terms of p == 2, phi(x / (2 * m), 0) == x / (2 * m)
+    for (uint64_t m = (y >> 1U) + 1U; m <= y; ++m) {
+        if (mu[m] && (m & 1U)) {
+            phi -= (mu[m] > 0) ? (x / (m << 1U)) : (0U - (x / (m << 1U)));
+        }
+    }
+
+    // The rest of the special terms, -mu(m) * phi(x / (p_b * m), b - 1)
+    // for lpf(m) > p_b and m <= y < p_b * m, come from a segmented sieve
+    // of the odd numbers in [1, z], crossing off one prime more per b.
+    // phiBelow[b] is phi(low - 1, b - 1), at the start of each segment.
+    std::vector<uint64_t> phiBelow(a + 1U, 0U);
+    PhiSegment segment(phiSegmentWords);
+    QIMCIFA_STAT(AddSieveStat(SIEVE_STAT_BYTES_ALLOCATED, (a + 1U) * sizeof(uint64_t) + phiSegmentWords * (sizeof(uint64_t) + sizeof(uint32_t))));
+    const uint64_t segmentSpan = (uint64_t)segment.bits.size() << 7U;
+    SieveMonitor* monitor = CurrentSieveMonitor();
+    if (monitor) {
+        monitor->AddSegments((z + segmentSpan - 1U) / segmentSpan);
+    }
+    for (uint64_t low = 1U; low <= z; low += segmentSpan) {
+        if (monitor) {
+            monitor->Check();
+            monitor->Step();
+        }
+        const uint64_t high = low + segmentSpan;
+        segment.Reset(low, z + 1U);
+        for (size_t k = 1U; k < a; ++k) {
+            const uint64_t p = primes[k];
+            if (k > 1U) {
+                segment.CrossOff(primes[k - 1U]);
+            }
+
+            // The terms of this segment have m in (mLo, mHi].
+            const uint64_t mHi = std::min(y, x / (p * low));
+            if (((k + 1U) >= primes.size()) || (mHi < primes[k + 1U])) {
+                // ... and no m has lpf(m) > p, here or in any segment past it.
+                break;
+            }
+            const uint64_t mLo = std::max(y / p, x / (p * high));
+            uint64_t& below = phiBelow[k + 1U];
+            if ((p * p) <= y) {
+                for (uint64_t m = mHi; m > mLo; --m) {
+                    if (mu[m] && (lpf[m] > p)) {
+                        const uint64_t leaf = below + segment.CountTo(x / (p * m));
+                        phi -= (mu[m] > 0) ? leaf : (0U - leaf);
+                    }
+                }
+            } else {
+                // Every such m is prime.
+                const size_t last = std::distance(primes.begin(), std::upper_bound(primes.begin(), primes.begin() + a, mHi));
+                for (size_t j = std::distance(primes.begin(), std::upper_bound(primes.begin() + k + 1U, primes.begin() + a, mLo)); j < last;
+                     ++j) {
+                    phi += below + segment.CountTo(x / (p * primes[j]));
+                }
+            }
+            below += segment.count;
+        }
+    }
+    QIMCIFA_STAT(clock.Lap(SIEVE_PHASE_PHI));
+
+    // P2(x, a) == sum, over the primes p_k in (y, sqrt(x)], of pi(x / p_k) - (k - 1),
+    // where x / p_k runs up through [sqrt(x), z] as p_k runs down. The p_k
+    // are sieved from the top down, a chunk at a time, just ahead of the
+    // segment that needs them, (and before it takes the segment buffer).
+    uint64_t p2 = 0U;
+    const SieveWindow<uint64_t, Wheel30> window(0U, z + 1U, 0U);
+    const uint64_t segmentValues = (uint64_t)window.span / Wheel30::count * Wheel30::modulus;
+    SieveCursor cursor;
+    uint64_t pi = window.wheelPrimes.size();
+    // The p_k sieved so far, from the top down, and the next to use
+    std::vector<uint64_t> topPrimes;
+    size_t next = 0U;
+    uint64_t sievedLo = root + 1U;
+    // pi(sqrt(x)), once every p_k is counted
+    uint64_t b = a;
+    for (size_t s = 0U; (s < window.segmentCount) && ((sievedLo > (y + 1U)) || (next < topPrimes.size())); ++s) {
+        const uint64_t fHi = (s + 1U) * segmentValues;
+        // This segment takes every p_k with x / p_k < fHi, or p_k > x / fHi.
+        const uint64_t pLo = std::max(y, x / fHi) + 1U;
+        while (sievedLo > pLo) {
+            const uint64_t chunkHi = sievedLo;
+            sievedLo = std::max(y + 1U, (chunkHi > lmoChunkSpan) ? (chunkHi - lmoChunkSpan) : (uint64_t)0U);
+            const std::vector<uint64_t> chunk = SegmentedSieveRange<uint64_t>(sievedLo, chunkHi);
+            topPrimes.erase(topPrimes.begin(), topPrimes.begin() + next);
+            topPrimes.insert(topPrimes.end(), chunk.rbegin(), chunk.rend());
+            next = 0U;
+        }
+
+        unsigned char* notPrime = GetSegmentBuffer(window.segmentBytes);
+        size_t first, last;
+        const uint64_t fLo = window.Sieve(s, notPrime, first, last, cursor);
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_SCAN));
+        for (; (next < topPrimes.size()) && ((x / topPrimes[next]) < fHi); ++next, ++b) {
+            const size_t o = std::max(first, std::min(last, GetCandidateOffset<Wheel30>(fLo, (x / topPrimes[next]) + 1U)));
+            pi += CountClearBits(notPrime, first, o);
+            first = o;
+            p2 += pi;
+        }
+        pi += CountClearBits(notPrime, first, last);
+    }
+    // ... less the sum of k - 1, for k in (a, b]
+    p2 -= (b * (b - 1U) - (uint64_t)a * (a - 1U)) >> 1U;
+
+    return phi + a - 1U - p2;
+}
+
+} // namespace qimcifa
@@ -0,0 +1,311 @@
+// Patterns among consecutive primes, (gaps past some width, or prime
+// k-tuples, such as twins and cousins,) found in each segment while its
+// bit set is in cache, so that only the matches ever leave the engine.
+//
+// Each segment scans into a Block of its own, in parallel: the matches
+// wholly within it, and what it takes to join it to its neighbours, (the
+// primes within reach of either end). Blocks then join in order, which
+// finds the matches that cross from one segment into the next.
+//
+// Each scan has Event, Block, and Carry types, and the members:
+//     Scan<W>(block, bits, first, last, fLo, endF)
+//                             fills block from the clear bits [first, last)
+//                             of a segment of wheel W, whose values run
+//                             from fLo up to fLo + endF
+//     Start(carry, wheelPrimes, hi, out)
+//                             appends the matches that start at wheel primes
+//     Join(carry, block, out) appends the matches of block and of its join
+//                             to the blocks before it, (summed up by carry)
+
+#pragma once
+
+#include "eratosthenes.hpp"
+#include "primality.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+namespace qimcifa {
+
+// Is value v, (counting from the start of a segment,) a prime in it? (As
+// for any value below the segment's endF, its bit is within the window.)
+template <typename W> inline bool IsClearCandidate(const unsigned char* bits, const size_t& v)
+{
+    const size_t o = (v / W::modulus) * W::count + W::Index(v % W::modulus);
+    return (W::Forward(o) == v) && !IsBitSet(bits, o);
+}
+
+// Each gap of at least "minGap" between consecutive primes, as the
+// prime before it and the width of the gap
+template <typename BigInt> struct PrimeGapScan {
+    typedef std::pair<BigInt, size_t> Event;
+    struct Block {
+        bool isEmpty;
+        BigInt first;
+        BigInt last;
+        std::vector<Event> events;
+    };
+    struct Carry {
+        bool isEmpty;
+        BigInt last;
+
+        Carry()
+            : isEmpty(true)
+            , last(0U)
+        {
+            // Intentionally left blank
+        }
+    };
+    size_t minGap;
+
+    PrimeGapScan(const size_t& g)
+        : minGap(g)
+    {
+        // Intentionally left blank
+    }
+
+    // Any gap fits between two segments.
+    size_t Reach() const { return 0U; }
+
+    template <typename W>
+    void Scan(Block& block, const unsigned char* bits, const size_t& first, const size_t& last, const BigInt& fLo, const size_t&) const
+    {
+        bool isEmpty = true;
+        size_t firstF = 0U, lastF = 0U;
+        ForEachClearBit(bits, first, last, [&](const size_t& o) {
+            const size_t f = W::Forward(o);
+            if (isEmpty) {
+                isEmpty = false;
+                firstF = f;
+            } else if ((f - lastF) >= minGap) {
+                block.events.emplace_back(fLo + (BigInt)lastF, f - lastF);
+            }
+            lastF = f;
+        });
+
+        block.isEmpty = isEmpty;
+        block.first = fLo + (BigInt)firstF;
+        block.last = fLo + (BigInt)lastF;
+    }
+
+    void Start(Carry& carry, const std::vector<BigInt>& wheelPrimes, const BigInt&, std::vector<Event>& out) const
+    {
+        for (const BigInt& p : wheelPrimes) {
+            if (!carry.isEmpty && ((size_t)(p - carry.last) >= minGap)) {
+                out.emplace_back(carry.last, (size_t)(p - carry.last));
+            }
+            carry.isEmpty = false;
+            carry.last = p;
+        }
+    }
+
+    void Join(Carry& carry, const Block& block, std::vector<Event>& out) const
+    {
+        if (block.isEmpty) {
+            return;
+        }
+        if (!carry.isEmpty && ((size_t)(block.first - carry.last) >= minGap)) {
+            out.emplace_back(carry.last, (size_t)(block.first - carry.last));
+        }
+        out.insert(out.end(), block.events.begin(), block.events.end());
+        carry.isEmpty = false;
+        carry.last = block.last;
+    }
+};
+
+// Each p for which p + d is prime, for every d of "pattern" (e.g., { 0, 2 }
+// for twin primes, { 0, 4 } for cousins, or { 0, 2, 6 } for triplets)
+template <typename BigInt> struct PrimeTupleScan {
+    typedef BigInt Event;
+    struct Block {
+        BigInt fLo;
+        std::vector<Event> events;
+        // The primes within "diameter" of the start, and of the end, of the segment
+        std::vector<BigInt> head;
+        std::vector<BigInt> tail;
+    };
+    struct Carry {
+        std::vector<BigInt> tail;
+    };
+    // Sorted, from 0
+    std::vector<size_t> pattern;
+    size_t diameter;
+
+    PrimeTupleScan(const std::vector<size_t>& offsets)
+        : pattern(offsets)
+        , diameter(0U)
+    {
+        if (pattern.empty()) {
+            throw std::invalid_argument("A prime tuple pattern needs at least one offset.");
+        }
+        std::sort(pattern.begin(), pattern.end());
+        pattern.erase(std::unique(pattern.begin(), pattern.end()), pattern.end());
+        const size_t least = pattern.front();
+        for (size_t& d : pattern) {
+            d -= least;
+        }
+        diameter = pattern.back();
+    }
+
+    // Every tuple must fit between two segments.
+    size_t Reach() const { return diameter; }
+
+    template <typename W>
+    void Scan(Block& block, const unsigned char* bits, const size_t& first, const size_t& last, const BigInt& fLo, const size_t& endF) const
+    {
+        block.fLo = fLo;
+        ForEachClearBit(bits, first, last, [&](const size_t& o) {
+            const size_t f = W::Forward(o);
+            if (f < diameter) {
+                block.head.push_back(fLo + (BigInt)f);
+            }
+            if ((f + diameter) >= endF) {
+                block.tail.push_back(fLo + (BigInt)f);
+                return;
+            }
+            for (size_t i = 1U; i < pattern.size(); ++i) {
+                if (!IsClearCandidate<W>(bits, f + pattern[i])) {
+                    return;
+                }
+            }
+            block.events.push_back(fLo + (BigInt)f);
+        });
+    }
+
+    void Start(Carry&, const std::vector<BigInt>& wheelPrimes, const BigInt& hi, std::vector<Event>& out) const
+    {
+        // Every member past a wheel prime is below 7 + diameter, (which is
+        // less than one segment,) so a deterministic test settles it.
+        for (const BigInt& p : wheelPrimes) {
+            bool isMatch = true;
+            for (const size_t& d : pattern) {
+                const BigInt v = p + (BigInt)d;
+                if ((v >= hi) || !IsPrime((uint64_t)v)) {
+                    isMatch = false;
+                    break;
+                }
+            }
+            if (isMatch) {
+                out.push_back(p);
+            }
+        }
+    }
+
+    void Join(Carry& carry, const Block& block, std::vector<Event>& out) const
+    {
+        // A tuple that crosses into this block ends in its head, and starts
+        // in the tail of the block just before it.
+        for (const BigInt& q : block.head) {
+            if (carry.tail.empty()) {
+                break;
+            }
+            if (q < diameter) {
+                continue;
+            }
+            const BigInt p = q - (BigInt)diameter;
+            if (!std::binary_search(carry.tail.begin(), carry.tail.end(), p)) {
+                continue;
+            }
+            bool isMatch = true;
+            for (size_t i = 1U; (i + 1U) < pattern.size(); ++i) {
+                const BigInt v = p + (BigInt)pattern[i];
+                const std::vector<BigInt>& side = (v < block.fLo) ? carry.tail : block.head;
+                if (!std::binary_search(side.begin(), side.end(), v)) {
+                    isMatch = false;
+                    break;
+                }
+            }
+            if (isMatch) {
+                out.push_back(p);
+            }
+        }
+        out.insert(out.end(), block.events.begin(), block.events.end());
+        carry.tail = block.tail;
+    }
+};
+
+// Yields the matches of a scan over [lo, hi), in order, a batch of
+// segments at a time, sieving and scanning each batch over "threads"
+// threads, (0 for all,) so that peak memory stays a few segments.
+template <typename BigInt, typename W, typename Op> class PrimePatternIterator {
+protected:
+    SieveWindow<BigInt, W> window;
+    Op op;
+    BigInt hi;
+    unsigned threads;
+    size_t batch;
+    size_t segment;
+    bool isStarted;
+    typename Op::Carry carry;
+    std::vector<SieveCursor> cursors;
+
+public:
+    PrimePatternIterator(const BigInt& l, const BigInt& h, const Op& o, size_t segmentBytes = 0U, unsigned t = 1U)
+        : window(l, h, segmentBytes)
+        , op(o)
+        , hi(h)
+        , threads(t ? t : GetDefaultThreadCount())
+        // Each thread takes a run of consecutive segments from a batch.
+        , batch(threads * 8U)
+        , segment(0U)
+        , isStarted(false)
+        , cursors(threads)
+    {
+        if (op.Reach() >= (window.periods * W::modulus)) {
+            throw std::invalid_argument("The pattern must span less than one segment.");
+        }
+    }
+
+    bool IsDone() const { return isStarted && (segment >= window.segmentCount); }
+
+    // Returns the matches of the next batch of segments, in order. (Some
+    // batches might have none, so check IsDone() instead.)
+    std::vector<typename Op::Event> Next()
+    {
+        std::vector<typename Op::Event> out;
+        if (!isStarted) {
+            isStarted = true;
+            op.Start(carry, window.wheelPrimes, hi, out);
+        }
+        if (IsDone()) {
+            return out;
+        }
+
+        // (as for SegmentedSieveIterator)
+        window.monitor = CurrentSieveMonitor();
+        const size_t count = std::min(batch, window.segmentCount - segment);
+        std::vector<typename Op::Block> blocks(count);
+        ParallelFor(count, threads, [&](const size_t& i, const unsigned& cpu) {
+            unsigned char* notPrime = GetSegmentBuffer(window.segmentBytes);
+            size_t first, last;
+            const BigInt fLo = window.Sieve(segment + i, notPrime, first, last, cursors[cpu]);
+            const size_t endF = (last == window.span) ? (window.periods * W::modulus) : W::Forward(last);
+            QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_SCAN));
+
+            op.template Scan<W>(blocks[i], notPrime, first, last, fLo, endF);
+        });
+        segment += count;
+
+        for (const typename Op::Block& block : blocks) {
+            op.Join(carry, block, out);
+        }
+
+        return out;
+    }
+};
+
+// Returns every match of a scan over [lo, hi), in order.
+template <typename BigInt, typename W = Wheel30, typename Op>
+std::vector<typename Op::Event> SegmentedPatternRange(
+    const BigInt& lo, const BigInt& hi, const Op& op, size_t segmentBytes = 0U, unsigned threads = 1U)
+{
+    PrimePatternIterator<BigInt, W, Op> it(lo, hi, op, segmentBytes, threads);
+    std::vector<typename Op::Event> out;
+    while (!it.IsDone()) {
+        const std::vector<typename Op::Event> next = it.Next();
+        out.insert(out.end(), next.begin(), next.end());
+    }
+
+    return out;
+}
+} // namespace qimcifa
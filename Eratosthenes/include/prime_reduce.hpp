@@ -0,0 +1,232 @@
+// Reductions over the primes of a window, folded into each segment while
+// its bit set is still in cache, so that no list of the primes is built.
+//
+// Each op has a Partial result type and the members:
+//     Identity()                          the Partial of no primes at all
+//     Add(part, p)                        folds in one prime p
+//     Fold<W>(part, bits, first, last, fLo)
+//                                         folds in the clear bits [first, last)
+//                                         of a segment of wheel W, from fLo
+//     Merge(part, next)                   folds in "next," which follows "part"
+// If isOrdered, every segment folds into its own Partial, and these merge
+// in order. Otherwise, each thread folds all of its segments into one.
+
+#pragma once
+
+#include "eratosthenes.hpp"
+
+namespace qimcifa {
+
+template <typename BigInt> struct PrimeCountOp {
+    typedef uint64_t Partial;
+    static constexpr bool isOrdered = false;
+
+    Partial Identity() const { return 0U; }
+
+    void Add(Partial& part, const BigInt&) const { ++part; }
+
+    template <typename W>
+    void Fold(Partial& part, const unsigned char* bits, const size_t& first, const size_t& last, const BigInt&) const
+    {
+        part += CountClearBits(bits, first, last);
+    }
+
+    void Merge(Partial& part, const Partial& next) const { part += next; }
+};
+
+// The sum of p, or of p * p, over the primes.
+template <typename BigInt, unsigned Power> struct PrimePowerSumOp {
+    static_assert((Power == 1U) || (Power == 2U), "Only sums of primes and of their squares are supported.");
+    typedef BigInteger Partial;
+    static constexpr bool isOrdered = false;
+
+    Partial Identity() const { return 0U; }
+
+    void Add(Partial& part, const BigInt& p) const { part += (Power == 1U) ? BigInteger(p) : BigInteger(p) * BigInteger(p); }
+
+    template <typename W>
+    void Fold(Partial& part, const unsigned char* bits, const size_t& first, const size_t& last, const BigInt& fLo) const
+    {
+        // Each prime is fLo + f, for an offset f below 2^32, so the sums of
+        // f and f * f, (the latter in two words,) are exact in native words.
+        uint64_t count = 0U, sum = 0U, squaresLo = 0U, squaresHi = 0U;
+        ForEachClearBit(bits, first, last, [&](const size_t& o) {
+            const uint64_t f = W::Forward(o);
+            ++count;
+            sum += f;
+            if (Power == 2U) {
+                squaresLo += f * f;
+                squaresHi += (squaresLo < (f * f)) ? 1U : 0U;
+            }
+        });
+
+        const BigInteger lo = fLo;
+        if (Power == 1U) {
+            part += lo * count + sum;
+        } else {
+            part += lo * lo * count + 2U * lo * sum + ((BigInteger(squaresHi) << 64U) | squaresLo);
+        }
+    }
+
+    void Merge(Partial& part, const Partial& next) const { part += next; }
+};
+
+// The greatest modulus of PrimeResidueCountOp, as every thread
+// keeps its own counts, (of 8 MB, at this bound,) for every class
+constexpr size_t maxResidueModulus = (size_t)1U << 20U;
+
+// The count of primes in each residue class modulo "modulus"
+template <typename BigInt> struct PrimeResidueCountOp {
+    typedef std::vector<uint64_t> Partial;
+    static constexpr bool isOrdered = false;
+    size_t modulus;
+
+    PrimeResidueCountOp(const size_t& m)
+        : modulus(m)
+    {
+        if (!modulus || (modulus > maxResidueModulus)) {
+            throw std::invalid_argument("The residues op needs a modulus from 1 to 2^20.");
+        }
+    }
+
+    Partial Identity() const { return Partial(modulus, 0U); }
+
+    void Add(Partial& part, const BigInt& p) const { ++part[(size_t)(p % modulus)]; }
+
+    template <typename W>
+    void Fold(Partial& part, const unsigned char* bits, const size_t& first, const size_t& last, const BigInt& fLo) const
+    {
+        const uint64_t r = (uint64_t)(fLo % modulus);
+        ForEachClearBit(bits, first, last, [&](const size_t& o) { ++part[(size_t)((r + W::Forward(o)) % modulus)]; });
+    }
+
+    void Merge(Partial& part, const Partial& next) const
+    {
+        for (size_t i = 0U; i < modulus; ++i) {
+            part[i] += next[i];
+        }
+    }
+};
+
+// The widest gap between consecutive primes, (the first, of any ties,)
+// and the prime just before it
+template <typename BigInt> struct PrimeMaxGapOp {
+    struct Partial {
+        bool isEmpty;
+        BigInt first;
+        BigInt last;
+        BigInt gap;
+        BigInt after;
+
+        Partial()
+            : isEmpty(true)
+            , first(0U)
+            , last(0U)
+            , gap(0U)
+            , after(0U)
+        {
+            // Intentionally left blank
+        }
+    };
+    static constexpr bool isOrdered = true;
+
+    Partial Identity() const { return Partial(); }
+
+    void Add(Partial& part, const BigInt& p) const
+    {
+        Partial next;
+        next.isEmpty = false;
+        next.first = p;
+        next.last = p;
+        Merge(part, next);
+    }
+
+    template <typename W>
+    void Fold(Partial& part, const unsigned char* bits, const size_t& first, const size_t& last, const BigInt& fLo) const
+    {
+        // Gaps within the segment are differences of native offsets.
+        bool isEmpty = true;
+        size_t firstF = 0U, lastF = 0U, gap = 0U, after = 0U;
+        ForEachClearBit(bits, first, last, [&](const size_t& o) {
+            const size_t f = W::Forward(o);
+            if (isEmpty) {
+                isEmpty = false;
+                firstF = f;
+            } else if ((f - lastF) > gap) {
+                gap = f - lastF;
+                after = lastF;
+            }
+            lastF = f;
+        });
+        if (isEmpty) {
+            return;
+        }
+
+        Partial next;
+        next.isEmpty = false;
+        next.first = fLo + (BigInt)firstF;
+        next.last = fLo + (BigInt)lastF;
+        next.gap = gap;
+        next.after = fLo + (BigInt)after;
+        Merge(part, next);
+    }
+
+    void Merge(Partial& part, const Partial& next) const
+    {
+        if (next.isEmpty) {
+            return;
+        }
+        if (part.isEmpty) {
+            part = next;
+            return;
+        }
+        if ((BigInt)(next.first - part.last) > part.gap) {
+            part.gap = next.first - part.last;
+            part.after = part.last;
+        }
+        if (next.gap > part.gap) {
+            part.gap = next.gap;
+            part.after = next.after;
+        }
+        part.last = next.last;
+    }
+};
+
+// Reduces the primes in [lo, hi) by "op," sieving just that window.
+template <typename BigInt, typename W = Wheel30, typename Op>
+typename Op::Partial SegmentedReduceRange(const BigInt& lo, const BigInt& hi, const Op& op, size_t segmentBytes = 0U, unsigned threads = 1U)
+{
+    const SieveWindow<BigInt, W> window(lo, hi, segmentBytes);
+    if (!threads) {
+        threads = GetDefaultThreadCount();
+    }
+    std::vector<typename Op::Partial> partials(Op::isOrdered ? window.segmentCount : threads, op.Identity());
+    std::vector<SieveCursor> cursors(threads);
+
+    ParallelFor(window.segmentCount, threads, [&](const size_t& s, const unsigned& cpu) {
+        unsigned char* notPrime = GetSegmentBuffer(window.segmentBytes);
+        size_t first, last;
+        const BigInt fLo = window.Sieve(s, notPrime, first, last, cursors[cpu]);
+        QIMCIFA_STAT(const SieveStatTimer timer(SIEVE_PHASE_SCAN));
+
+        op.template Fold<W>(partials[Op::isOrdered ? s : cpu], notPrime, first, last, fLo);
+    });
+
+    typename Op::Partial result = op.Identity();
+    for (const BigInt& p : window.wheelPrimes) {
+        op.Add(result, p);
+    }
+    for (const typename Op::Partial& part : partials) {
+        op.Merge(result, part);
+    }
+
+    return result;
+}
+
+// Reduces the primes up to n by "op."
+template <typename BigInt, typename W = Wheel30, typename Op>
+typename Op::Partial SegmentedReduce(const BigInt& n, const Op& op, size_t segmentBytes = 0U, unsigned threads = 1U)
+{
+    return SegmentedReduceRange<BigInt, W>((BigInt)0U, (BigInt)(n + 1U), op, segmentBytes, threads);
+}
+} // namespace qimcifa
@@ -0,0 +1,332 @@
+// A prime table file holds the primes below some bound, mapped back into
+// memory on load, so that counts, ranges, and primality tests up to that
+// bound come straight from the page cache, (shared by every process on
+// the host that maps the same file,) without sieving anything.
+//
+// The primes are stored as the mod-30 bit set of the sieve, where bit k
+// of byte b is set if and only if 30 * b + Wheel30::Residue(k) is prime, so each
+// byte covers 30 integers. (2, 3, and 5 are implied.) An index gives the
+// number of primes set in the bit set before each block of it.
+//
+// File layout, with every integer little-endian:
+//   [0, 64)          header
+//     [0, 8)         magic, "QIMCIFA" and a 0 byte
+//     [8, 12)        format version (1)
+//     [12, 16)       wheel modulus (30)
+//     [16, 24)       bound, (the table covers [0, bound))
+//     [24, 32)       bytes per block
+//     [32, 40)       block count
+//     [40, 48)       bytes of bit set, (ceil(bound / 30))
+//     [48, 56)       offset of the bit set, (page-aligned)
+//     [56, 64)       reserved (0)
+//   [64, ...)        index, of (block count + 1) uint64, where entry b
+//                    is the count of set bits before block b
+//   [offset, ...)    bit set
+
+#pragma once
+
+#include "eratosthenes.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define QIMCIFA_MMAP 1
+#endif
+
+namespace qimcifa {
+
+constexpr char primeTableMagic[8U] = { 'Q', 'I', 'M', 'C', 'I', 'F', 'A', 0 };
+constexpr uint32_t primeTableVersion = 1U;
+constexpr size_t primeTableHeaderBytes = 64U;
+// One block per page, so a count reads one page of the bit set at most.
+constexpr size_t primeTableBlockBytes = 4096U;
+
+inline uint64_t LoadLE64(const unsigned char* bytes)
+{
+    uint64_t v = 0U;
+    for (size_t i = 0U; i < 8U; ++i) {
+        v |= (uint64_t)bytes[i] << (i << 3U);
+    }
+
+    return v;
+}
+
+inline void StoreLE64(unsigned char* bytes, const uint64_t& v)
+{
+    for (size_t i = 0U; i < 8U; ++i) {
+        bytes[i] = (unsigned char)(v >> (i << 3U));
+    }
+}
+
+// Returns the whole prime table file, in memory, of every prime up to
+// n, from one sieve pass over "threads" threads, (0 for all).
+inline std::vector<unsigned char> MakePrimeTable(const uint64_t& n, unsigned threads = 0U)
+{
+    const uint64_t bound = n + 1U;
+    const size_t bitBytes = (size_t)((bound + 29U) / 30U);
+    const size_t blockCount = (bitBytes + primeTableBlockBytes - 1U) / primeTableBlockBytes;
+    const size_t indexEnd = primeTableHeaderBytes + ((blockCount + 1U) << 3U);
+    const size_t offset = ((indexEnd + primeTableBlockBytes - 1U) / primeTableBlockBytes) * primeTableBlockBytes;
+    std::vector<unsigned char> table(offset + bitBytes, 0U);
+    unsigned char* bits = table.data() + offset;
+
+    // With wheel 30 from 0, bit o of segment s is bit (s * span + o) of
+    // the whole bit set, so each segment fills its own bytes of it.
+    if (!threads) {
+        threads = GetDefaultThreadCount();
+    }
+    const SieveWindow<uint64_t, Wheel30> window(0U, bound, 0U);
+    std::vector<SieveCursor> cursors(threads);
+    ParallelFor(window.segmentCount, threads, [&](const size_t& s, const unsigned& cpu) {
+        unsigned char* notPrime = GetSegmentBuffer(window.segmentBytes);
+        size_t first, last;
+        window.Sieve(s, notPrime, first, last, cursors[cpu]);
+
+        unsigned char* out = bits + s * (window.span >> 3U);
+        ForEachClearBit(notPrime, first, last, [&](const size_t& o) { SetBit(out, o); });
+    });
+
+    std::vector<uint64_t> index(blockCount + 1U, 0U);
+    ParallelFor(blockCount, threads, [&](const size_t& b, const unsigned&) {
+        const size_t begin = b * primeTableBlockBytes;
+        index[b + 1U] = GetPopCountBytesKernel()(bits + begin, std::min(primeTableBlockBytes, bitBytes - begin));
+    });
+    for (size_t b = 0U; b < blockCount; ++b) {
+        index[b + 1U] += index[b];
+    }
+
+    std::memcpy(table.data(), primeTableMagic, sizeof(primeTableMagic));
+    for (size_t i = 0U; i < 4U; ++i) {
+        table[8U + i] = (unsigned char)(primeTableVersion >> (i << 3U));
+        table[12U + i] = (unsigned char)(30U >> (i << 3U));
+    }
+    StoreLE64(table.data() + 16U, bound);
+    StoreLE64(table.data() + 24U, primeTableBlockBytes);
+    StoreLE64(table.data() + 32U, blockCount);
+    StoreLE64(table.data() + 40U, bitBytes);
+    StoreLE64(table.data() + 48U, offset);
+    for (size_t b = 0U; b <= blockCount; ++b) {
+        StoreLE64(table.data() + primeTableHeaderBytes + (b << 3U), index[b]);
+    }
+
+    return table;
+}
+
+// Writes a prime table of every prime up to n, (sieved over "threads"
+// threads, 0 for all,) to the file at "path."
+inline void WritePrimeTable(const std::string& path, const uint64_t& n, unsigned threads = 0U)
+{
+    const std::vector<unsigned char> table = MakePrimeTable(n, threads);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(table.data()), table.size());
+    if (!file) {
+        throw std::runtime_error("Could not write the prime table to " + path + ".");
+    }
+}
+
+// A prime table, mapped read-only into memory from a file, (or read
+// into it, where there is no mmap(),) or just built in memory. Either
+// way, Count() is one lookup in the index and one partial population
+// count, of one block at most.
+class PrimeTable {
+protected:
+    const unsigned char* data;
+    size_t dataBytes;
+    bool isMapped;
+    std::vector<unsigned char> buffer;
+    uint64_t bound;
+    size_t blockCount;
+    size_t bitBytes;
+    const unsigned char* index;
+    const unsigned char* bits;
+
+    // Counts the primes of the bit set below bit i.
+    uint64_t CountBits(const size_t& i) const
+    {
+        const size_t b = (i >> 3U) / primeTableBlockBytes;
+        const size_t begin = (b * primeTableBlockBytes) << 3U;
+
+        return LoadLE64(index + (b << 3U)) + (i - begin) - CountClearBits(bits, begin, i);
+    }
+
+    void CheckBound(const uint64_t& hi) const
+    {
+        if (hi > bound) {
+            throw std::out_of_range("This query falls past the bound of the prime table.");
+        }
+    }
+
+    void Release()
+    {
+#if defined(QIMCIFA_MMAP)
+        if (isMapped) {
+            munmap(const_cast<unsigned char*>(data), dataBytes);
+        }
+#endif
+        data = NULL;
+        dataBytes = 0U;
+        isMapped = false;
+        std::vector<unsigned char>().swap(buffer);
+    }
+
+public:
+    // Checks the header of the table at "data," and finds its parts.
+    bool Attach()
+    {
+        const bool isTable = (dataBytes >= primeTableHeaderBytes) && !std::memcmp(data, primeTableMagic, sizeof(primeTableMagic)) &&
+            ((LoadLE64(data + 8U) & 0xFFFFFFFFU) == primeTableVersion) && ((LoadLE64(data + 8U) >> 32U) == 30U) &&
+            (LoadLE64(data + 24U) == primeTableBlockBytes);
+        bound = isTable ? LoadLE64(data + 16U) : 0U;
+        blockCount = isTable ? (size_t)LoadLE64(data + 32U) : 0U;
+        bitBytes = isTable ? (size_t)LoadLE64(data + 40U) : 0U;
+        const size_t offset = isTable ? (size_t)LoadLE64(data + 48U) : 0U;
+        if (!isTable || (bitBytes != ((bound + 29U) / 30U)) ||
+            (blockCount != ((bitBytes + primeTableBlockBytes - 1U) / primeTableBlockBytes)) ||
+            (offset < (primeTableHeaderBytes + ((blockCount + 1U) << 3U))) || (dataBytes < offset) ||
+            ((dataBytes - offset) < bitBytes)) {
+            return false;
+        }
+        index = data + primeTableHeaderBytes;
+        bits = data + offset;
+
+        return true;
+    }
+
+public:
+    // Maps the prime table file at "path."
+    PrimeTable(const std::string& path)
+        : data(NULL)
+        , dataBytes(0U)
+        , isMapped(false)
+    {
+#if defined(QIMCIFA_MMAP)
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open the prime table at " + path + ".");
+        }
+        struct stat st;
+        if (fstat(fd, &st) || (st.st_size < (off_t)primeTableHeaderBytes)) {
+            close(fd);
+            throw std::runtime_error("The file at " + path + " is not a prime table.");
+        }
+        dataBytes = (size_t)st.st_size;
+        void* mapped = mmap(NULL, dataBytes, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Could not map the prime table at " + path + ".");
+        }
+        data = static_cast<const unsigned char*>(mapped);
+        isMapped = true;
+#else
+        std::ifstream file(path, std::ios::binary);
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (!file && !file.eof()) {
+            throw std::runtime_error("Could not open the prime table at " + path + ".");
+        }
+        data = buffer.data();
+        dataBytes = buffer.size();
+#endif
+
+        if (!Attach()) {
+            Release();
+            throw std::runtime_error("The file at " + path + " is not a prime table.");
+        }
+    }
+
+    // Builds a prime table of every prime up to n, in memory, from one
+    // sieve pass over "threads" threads, (0 for all).
+    PrimeTable(const uint64_t& n, unsigned threads = 0U)
+        : isMapped(false)
+        , buffer(MakePrimeTable(n, threads))
+    {
+        data = buffer.data();
+        dataBytes = buffer.size();
+        if (!Attach()) {
+            Release();
+            throw std::runtime_error("Could not build a prime table up to " + std::to_string(n) + ".");
+        }
+    }
+
+    PrimeTable(const PrimeTable&) = delete;
+    PrimeTable& operator=(const PrimeTable&) = delete;
+
+    ~PrimeTable() { Release(); }
+
+    // The table covers [0, Bound()).
+    uint64_t Bound() const { return bound; }
+
+    bool IsPrime(const uint64_t& n) const
+    {
+        if (n >= bound) {
+            CheckBound(~(uint64_t)0U);
+        }
+        if (n < 7U) {
+            return (n == 2U) || (n == 3U) || (n == 5U);
+        }
+        if (!(n % 2U) || !(n % 3U) || !(n % 5U)) {
+            return false;
+        }
+
+        return IsBitSet(bits, GetCandidateOffset<Wheel30>((uint64_t)0U, n));
+    }
+
+    // Counts the primes in [lo, hi).
+    uint64_t CountRange(const uint64_t& lo, const uint64_t& hi) const
+    {
+        if (hi <= lo) {
+            return 0U;
+        }
+        CheckBound(hi);
+
+        uint64_t count = CountBits(GetCandidateOffset<Wheel30>((uint64_t)0U, hi)) -
+            CountBits(GetCandidateOffset<Wheel30>((uint64_t)0U, lo));
+        for (const unsigned p : { 2U, 3U, 5U }) {
+            if ((lo <= p) && (p < hi)) {
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    // Counts the primes up to n.
+    uint64_t Count(const uint64_t& n) const
+    {
+        // (Checked first, as n + 1 wraps at the top of the type.)
+        CheckBound(n);
+
+        return CountRange(0U, n + 1U);
+    }
+
+    // Returns the primes in [lo, hi), in order.
+    std::vector<uint64_t> SieveRange(const uint64_t& lo, const uint64_t& hi) const
+    {
+        std::vector<uint64_t> primes;
+        if (hi <= lo) {
+            return primes;
+        }
+        CheckBound(hi);
+
+        for (const unsigned p : { 2U, 3U, 5U }) {
+            if ((lo <= p) && (p < hi)) {
+                primes.push_back(p);
+            }
+        }
+        const size_t first = GetCandidateOffset<Wheel30>((uint64_t)0U, lo);
+        const size_t last = GetCandidateOffset<Wheel30>((uint64_t)0U, hi);
+        primes.reserve(primes.size() + (size_t)(CountBits(last) - CountBits(first)));
+        ForEachSetBit(bits, first, last, [&](const size_t& o) { primes.push_back(Wheel30::Forward(o)); });
+
+        return primes;
+    }
+};
+} // namespace qimcifa
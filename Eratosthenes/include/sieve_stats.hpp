@@ -0,0 +1,169 @@
+// Counters of where the segmented sieves spend their time, for tuning the
+// segment size and thread count of a host with data, rather than guesswork.
+//
+// They are compiled in only with QIMCIFA_STATS defined, (as by building the
+// Python module with ERATOSTHENES_STATS=1,) and otherwise every hook below
+// is empty, so that the default build pays nothing at all for them.
+//
+// Counters are process-wide, and add up, since the last ResetSieveStats(),
+// over every sieve, and over every thread of each, (so phase times are in
+// thread-seconds, and they can exceed the wall time of a parallel run).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(QIMCIFA_STATS)
+#include <atomic>
+#include <chrono>
+#define QIMCIFA_STAT(...) __VA_ARGS__
+#else
+#define QIMCIFA_STAT(...)
+#endif
+
+namespace qimcifa {
+
+struct SieveStats {
+    // Growing the cache of base primes, (sieving them included)
+    double basePrimeSeconds;
+    // Finding each window's base primes, laying down the presieved
+    // pattern, and finding each prime's first multiple in a segment
+    double setupSeconds;
+    // Crossing off the multiples of the sieving primes
+    double crossOffSeconds;
+    // The final pass of the caller over each segment's clear bits
+    double scanSeconds;
+    // The terms of phi(x, a), for prime counts by LMO
+    double phiSeconds;
+    uint64_t segments;
+    // The base primes, up to sqrt(hi), of every window opened
+    uint64_t basePrimes;
+    // Every bit written by crossing off, (some more than once)
+    uint64_t crossOffs;
+    // Segment buffers, base prime tables, and sieving prime lists
+    uint64_t bytesAllocated;
+};
+
+#if defined(QIMCIFA_STATS)
+constexpr bool isSieveStatsEnabled = true;
+
+enum SieveStat {
+    SIEVE_PHASE_BASE_PRIMES = 0,
+    SIEVE_PHASE_SETUP,
+    SIEVE_PHASE_CROSS_OFF,
+    SIEVE_PHASE_SCAN,
+    SIEVE_PHASE_PHI,
+    SIEVE_STAT_SEGMENTS,
+    SIEVE_STAT_BASE_PRIMES,
+    SIEVE_STAT_CROSS_OFFS,
+    SIEVE_STAT_BYTES_ALLOCATED,
+    SIEVE_STAT_COUNT
+};
+
+// (Phase times are in nanoseconds.)
+inline std::atomic<uint64_t>* GetSieveStatCounters()
+{
+    static std::atomic<uint64_t> counters[SIEVE_STAT_COUNT] = {};
+    return counters;
+}
+
+// While set, this thread's counts are dropped, (as the sieve of the base
+// primes, within a window that needs more of them, counts as that phase alone).
+inline bool& IsSieveStatPaused()
+{
+    thread_local bool isPaused = false;
+    return isPaused;
+}
+
+inline void AddSieveStat(const SieveStat& stat, const uint64_t& v)
+{
+    if (!IsSieveStatPaused()) {
+        GetSieveStatCounters()[stat].fetch_add(v, std::memory_order_relaxed);
+    }
+}
+
+// Adds the time since the last lap (or construction) to a phase, per lap.
+class SieveStatClock {
+protected:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    SieveStatClock()
+        : start(std::chrono::steady_clock::now())
+    {
+        // Intentionally left blank
+    }
+
+    void Lap(const SieveStat& phase)
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        AddSieveStat(phase, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+        start = now;
+    }
+};
+
+// Adds the time that it is in scope to a phase.
+class SieveStatTimer : public SieveStatClock {
+protected:
+    SieveStat phase;
+
+public:
+    SieveStatTimer(const SieveStat& p)
+        : phase(p)
+    {
+        // Intentionally left blank
+    }
+
+    ~SieveStatTimer() { Lap(phase); }
+};
+
+class PausedSieveStats {
+protected:
+    bool wasPaused;
+
+public:
+    PausedSieveStats()
+        : wasPaused(IsSieveStatPaused())
+    {
+        IsSieveStatPaused() = true;
+    }
+
+    ~PausedSieveStats() { IsSieveStatPaused() = wasPaused; }
+};
+
+inline SieveStats GetSieveStats()
+{
+    const std::atomic<uint64_t>* counters = GetSieveStatCounters();
+    SieveStats stats;
+    stats.basePrimeSeconds = counters[SIEVE_PHASE_BASE_PRIMES] * 1e-9;
+    stats.setupSeconds = counters[SIEVE_PHASE_SETUP] * 1e-9;
+    stats.crossOffSeconds = counters[SIEVE_PHASE_CROSS_OFF] * 1e-9;
+    stats.scanSeconds = counters[SIEVE_PHASE_SCAN] * 1e-9;
+    stats.phiSeconds = counters[SIEVE_PHASE_PHI] * 1e-9;
+    stats.segments = counters[SIEVE_STAT_SEGMENTS];
+    stats.basePrimes = counters[SIEVE_STAT_BASE_PRIMES];
+    stats.crossOffs = counters[SIEVE_STAT_CROSS_OFFS];
+    stats.bytesAllocated = counters[SIEVE_STAT_BYTES_ALLOCATED];
+
+    return stats;
+}
+
+inline void ResetSieveStats()
+{
+    std::atomic<uint64_t>* counters = GetSieveStatCounters();
+    for (size_t i = 0U; i < SIEVE_STAT_COUNT; ++i) {
+        counters[i] = 0U;
+    }
+}
+#else
+constexpr bool isSieveStatsEnabled = false;
+
+inline SieveStats GetSieveStats() { return SieveStats(); }
+
+inline void ResetSieveStats()
+{
+    // Intentionally left blank
+}
+#endif
+} // namespace qimcifa
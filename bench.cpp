@@ -0,0 +1,170 @@
+// Microbenchmarks of the qimcifa engines, called directly, (without Python,)
+// written as JSON to stdout, to track throughput from release to release.
+//
+// Build and run from the top of the repository, with Boost installed:
+//     g++ -std=c++17 -O3 -pthread -IEratosthenes/include bench.cpp -o bench_eratosthenes
+//     ./bench_eratosthenes [--max N] [--min-time SECONDS] [--filter NAME]
+//
+// Each case reports its fastest and median times, over as many runs as fit
+// in --min-time, (at least one,) and its throughput, in integers of its range
+// per second, and in candidates of its wheel per second. Bounds sweep by
+// powers of 10 from 10^3 up to --max, (10^10 by default; 10^12 takes many
+// minutes, in some modes, on one core,) and modes that list primes stop at 10^9.
+
+#include "eratosthenes.hpp"
+#include "prime_count.hpp"
+#include "prime_pattern.hpp"
+#include "prime_reduce.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace qimcifa;
+
+struct BenchOptions {
+    uint64_t max;
+    double minTime;
+    std::string filter;
+};
+
+struct BenchCase {
+    std::string name;
+    uint64_t lo;
+    uint64_t hi;
+    unsigned threads;
+    size_t segmentBytes;
+    unsigned wheel;
+    // Returns the result, (a count, or a size,) to print with the timings.
+    std::function<uint64_t()> run;
+};
+
+// The candidates of wheel 30 or 210 in [lo, hi), about
+double CountCandidates(const BenchCase& c)
+{
+    const double width = (double)(c.hi - c.lo);
+    return (c.wheel == 210U) ? (width * Wheel210::count / Wheel210::modulus) : (width * Wheel30::count / Wheel30::modulus);
+}
+
+void RunCase(const BenchCase& c, const BenchOptions& options, bool& isFirst)
+{
+    if (!options.filter.empty() && (c.name.find(options.filter) == std::string::npos)) {
+        return;
+    }
+    // (The base primes are built once, outside of any timing.)
+    WarmUpBasePrimes(c.hi);
+
+    std::vector<double> times;
+    double total = 0.0;
+    uint64_t result = 0U;
+    do {
+        const auto start = std::chrono::steady_clock::now();
+        result = c.run();
+        const double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        times.push_back(t);
+        total += t;
+    } while ((total < options.minTime) && (times.size() < 1000U));
+    std::sort(times.begin(), times.end());
+    const double best = std::max(times.front(), 1e-9);
+
+    std::cout << (isFirst ? "\n" : ",\n") << "    {\"name\": \"" << c.name << "\", \"lo\": " << c.lo << ", \"hi\": " << c.hi
+              << ", \"threads\": " << c.threads << ", \"segment_bytes\": " << NormalizeSegmentBytes(c.segmentBytes)
+              << ", \"wheel\": " << c.wheel << ", \"reps\": " << times.size() << ", \"seconds_min\": " << best
+              << ", \"seconds_median\": " << times[times.size() >> 1U]
+              << ", \"values_per_second\": " << ((double)(c.hi - c.lo) / best)
+              << ", \"candidates_per_second\": " << (CountCandidates(c) / best) << ", \"result\": " << result << "}";
+    std::cout.flush();
+    isFirst = false;
+}
+
+template <typename W> std::vector<BenchCase> GetWheelCases(const uint64_t& n, const unsigned& wheel, const size_t& bytes, const unsigned& threads)
+{
+    std::vector<BenchCase> cases;
+    cases.push_back({ "segmented_count", 0U, n + 1U, threads, bytes, wheel,
+        [=]() { return (uint64_t)SegmentedCountRange<uint64_t, W>(0U, n + 1U, bytes, threads); } });
+    if (n <= 1000000000ULL) {
+        cases.push_back({ "segmented_sieve", 0U, n + 1U, threads, bytes, wheel,
+            [=]() { return (uint64_t)SegmentedSieveRange<uint64_t, W>(0U, n + 1U, bytes, threads).size(); } });
+    }
+
+    return cases;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options{ 10000000000ULL, 0.5, "" };
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if ((arg == "--max") && ((i + 1) < argc)) {
+            options.max = (uint64_t)std::strtod(argv[++i], nullptr);
+        } else if ((arg == "--min-time") && ((i + 1) < argc)) {
+            options.minTime = std::strtod(argv[++i], nullptr);
+        } else if ((arg == "--filter") && ((i + 1) < argc)) {
+            options.filter = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--max N] [--min-time SECONDS] [--filter NAME]" << std::endl;
+            return 1;
+        }
+    }
+
+    const unsigned cores = GetDefaultThreadCount();
+    std::vector<BenchCase> cases;
+
+    // Every mode, over the sweep of bounds, on one thread
+    for (uint64_t n = 1000U; n <= options.max; n *= 10U) {
+        if (n <= 1000000000ULL) {
+            cases.push_back({ "sieve", 0U, n + 1U, 1U, 0U, 30U, [=]() { return (uint64_t)SieveOfEratosthenes(n).size(); } });
+            cases.push_back({ "count", 0U, n + 1U, 1U, 0U, 30U, [=]() { return (uint64_t)CountPrimesTo(n); } });
+        }
+        for (const BenchCase& c : GetWheelCases<Wheel30>(n, 30U, 0U, 1U)) {
+            cases.push_back(c);
+        }
+        if (n >= 1000000U) {
+            cases.push_back({ "count_lmo", 0U, n + 1U, 1U, 0U, 30U, [=]() { return CountPrimesLMO(n); } });
+        }
+    }
+
+    // Windows of 10^7, far from 0
+    for (uint64_t lo = 1000000000ULL; lo <= 10000000000000000ULL; lo *= 10U) {
+        const uint64_t hi = lo + 10000000U;
+        cases.push_back({ "count_range", lo, hi, 1U, 0U, 30U, [=]() { return (uint64_t)SegmentedCountRange<uint64_t>(lo, hi); } });
+        cases.push_back({ "sieve_range", lo, hi, 1U, 0U, 30U, [=]() { return (uint64_t)SegmentedSieveRange<uint64_t>(lo, hi).size(); } });
+    }
+
+    // Fused and pattern modes, against the plain count
+    const uint64_t n = std::min(options.max, (uint64_t)1000000000ULL);
+    cases.push_back({ "reduce_sum_squares", 0U, n + 1U, 1U, 0U, 30U,
+        [=]() { return (uint64_t)SegmentedReduce<uint64_t>(n, PrimePowerSumOp<uint64_t, 2U>()); } });
+    cases.push_back({ "gaps", 0U, n + 1U, 1U, 0U, 30U,
+        [=]() { return (uint64_t)SegmentedPatternRange<uint64_t>(0U, n + 1U, PrimeGapScan<uint64_t>(100U)).size(); } });
+    cases.push_back({ "twins", 0U, n + 1U, 1U, 0U, 30U,
+        [=]() { return (uint64_t)SegmentedPatternRange<uint64_t>(0U, n + 1U, PrimeTupleScan<uint64_t>({ 0U, 2U })).size(); } });
+
+    // The wheel, the thread count, and the segment size, each in turn
+    for (const BenchCase& c : GetWheelCases<Wheel210>(n, 210U, 0U, 1U)) {
+        cases.push_back(c);
+    }
+    for (unsigned threads = 2U; threads <= cores; threads <<= 1U) {
+        for (const BenchCase& c : GetWheelCases<Wheel30>(n, 30U, 0U, threads)) {
+            cases.push_back(c);
+        }
+    }
+    for (size_t bytes = 32768U; bytes <= 8388608U; bytes <<= 2U) {
+        for (const BenchCase& c : GetWheelCases<Wheel30>(n, 30U, bytes, 1U)) {
+            cases.push_back(c);
+        }
+    }
+
+    std::cout << "{\n  \"host\": {\"threads\": " << cores << ", \"default_segment_bytes\": " << NormalizeSegmentBytes(0U)
+              << ", \"l2_bytes\": " << DetectL2CacheBytes() << "},\n  \"results\": [";
+    bool isFirst = true;
+    for (const BenchCase& c : cases) {
+        RunCase(c, options, isFirst);
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    return 0;
+}
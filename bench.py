@@ -1,7 +1,99 @@
+import json
+import os
+import sys
 import time
-from Eratosthenes import segmented_count
+import _eratosthenes
+from Eratosthenes import count, count_range, segmented_count, segmented_sieve, segment_size, sieve, sieve_range, tune_segment_size
+from Eratosthenes import is_prime, merge_partials, partition, prime_gaps, prime_tuples, reduce_range, run_partition
 
 
+def option(name, default):
+    if name in sys.argv:
+        return type(default)(float(sys.argv[sys.argv.index(name) + 1]))
+    return default
+
+
+def time_case(results, name, fn, min_time, **params):
+    # As many runs as fit in min_time, (at least one,) through the public API
+    times = []
+    while not times or ((sum(times) < min_time) and (len(times) < 1000)):
+        start = time.perf_counter()
+        result = fn()
+        times.append(time.perf_counter() - start)
+    times.sort()
+    best = max(times[0], 1e-9)
+    params = dict(dict(threads=1, segment_bytes=segment_size()), **params)
+    width = params["hi"] - params["lo"]
+    results.append(dict(name=name, **params, reps=len(times), seconds_min=best, seconds_median=times[len(times) // 2],
+                        values_per_second=width / best, candidates_per_second=width * 8 / 30 / best,
+                        result=result if isinstance(result, int) else len(result)))
+    print(name, params, best, file=sys.stderr)
+
+
+def suite(max_n, min_time):
+    results = []
+    n = 1000
+    while n <= max_n:
+        span = dict(lo=0, hi=n + 1)
+        if n <= 1000000000:
+            time_case(results, "sieve", lambda: sieve(n), min_time, **span)
+            time_case(results, "sieve_numpy", lambda: sieve(n, numpy=True), min_time, **span)
+            time_case(results, "sieve_str", lambda: _eratosthenes._sieve(str(n)), min_time, **span)
+            time_case(results, "segmented_sieve", lambda: segmented_sieve(n, threads=1), min_time, **span)
+        time_case(results, "count", lambda: count(n), min_time, **span)
+        time_case(results, "count_str", lambda: int(_eratosthenes._count(str(n))), min_time, **span)
+        time_case(results, "segmented_count", lambda: segmented_count(n, threads=1), min_time, **span)
+        time_case(results, "count_range", lambda: count_range(0, n + 1, threads=1), min_time, **span)
+        n *= 10
+
+    lo = 1000000000
+    while lo <= 10000000000000000:
+        window = dict(lo=lo, hi=lo + 10000000)
+        time_case(results, "count_range", lambda: count_range(lo, lo + 10000000, threads=1), min_time, **window)
+        time_case(results, "sieve_range", lambda: sieve_range(lo, lo + 10000000, threads=1), min_time, **window)
+        lo *= 10
+
+    n = min(max_n, 1000000000)
+    threads = 2
+    while threads <= (os.cpu_count() or 1):
+        time_case(results, "count_range", lambda: count_range(0, n + 1, threads=threads), min_time, lo=0, hi=n + 1, threads=threads)
+        threads *= 2
+    for s in (32768, 131072, 524288, 2097152, 8388608):
+        time_case(results, "count_range", lambda: count_range(0, n + 1, s, 1), min_time, lo=0, hi=n + 1, segment_bytes=s)
+
+    return dict(host=dict(threads=os.cpu_count(), default_segment_bytes=segment_size()), results=results)
+
+
+if "--tune" in sys.argv:
+    # Report the best segment size (in bytes) for this host.
+    best, timings = tune_segment_size(1000000000)
+    for s in sorted(timings):
+        print(s, timings[s])
+    print("default:", segment_size())
+    print("best:", best)
+    sys.exit(0)
+
+if "--train" in sys.argv:
+    # One pass over every engine, to write a profile from a build with ERATOSTHENES_PGO=generate
+    suite(100000000, 0.0)
+    reduce_range(0, 100000001, "sum_squares", threads=1)
+    reduce_range(0, 100000001, "residues", modulus=4, threads=1)
+    prime_gaps(0, 100000001, 100, threads=1)
+    prime_tuples(0, 100000001, (0, 2, 6), threads=1)
+    is_prime(list(range(10**18, 10**18 + 10000)))
+    merge_partials([run_partition(c, threads=1) for c in partition(10**9, 4)])
+    sys.exit(0)
+
+if "--suite" in sys.argv:
+    # The whole sweep, as JSON, (to stdout, or to --out,) with progress on stderr
+    report = suite(option("--max", 10000000000), option("--min-time", 0.5))
+    if "--out" in sys.argv:
+        with open(sys.argv[sys.argv.index("--out") + 1], "w") as f:
+            json.dump(report, f, indent=2)
+    else:
+        print(json.dumps(report, indent=2))
+    sys.exit(0)
+
 start = time.perf_counter()
-print(segmented_count(1000000000))
+print(count_range(0, 10**9))
 print(time.perf_counter() - start)
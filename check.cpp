@@ -0,0 +1,94 @@
+// Regression checks of the qimcifa engines, called directly, (without Python,)
+// against known values of pi(x), and against each other.
+//
+// Build and run from the top of the repository, with Boost installed:
+//     g++ -std=c++17 -O3 -pthread -IEratosthenes/include check.cpp -o check_eratosthenes
+//     ./check_eratosthenes
+//
+// Each check prints "ok" or "FAIL", and the exit status is the count of
+// failures. The windows near 2^64 sieve every base prime up to 2^32, and
+// take a few minutes in all, mostly in BigInteger arithmetic.
+
+#include "eratosthenes.hpp"
+#include "prime_count.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace qimcifa;
+
+int failures = 0;
+
+void Check(const std::string& name, const BigInteger& got, const BigInteger& expected)
+{
+    const bool isOk = (got == expected);
+    std::cout << (isOk ? "ok   " : "FAIL ") << name << ": " << got;
+    if (!isOk) {
+        std::cout << " (expected " << expected << ")";
+        ++failures;
+    }
+    std::cout << std::endl;
+}
+
+// pi(10^k), for k from 0
+const uint64_t piPowersOf10[13U] = { 0U, 4U, 25U, 168U, 1229U, 9592U, 78498U, 664579U, 5761455U, 50847534U, 455052511U,
+    4118054813ULL, 37607912018ULL };
+
+template <typename W> void CheckSieves(const std::string& wheel)
+{
+    uint64_t n = 1U;
+    for (size_t k = 1U; k <= 9U; ++k) {
+        n *= 10U;
+        const std::string x = "10^" + std::to_string(k);
+        // (A small segment splits even small bounds over threads, and
+        // over many segments, to carry primes and buckets between them.)
+        const size_t segmentBytes = (k <= 6U) ? 4096U : 0U;
+        Check("SegmentedCountRange<" + wheel + ">(0, " + x + " + 1)", SegmentedCountRange<uint64_t, W>(0U, n + 1U, segmentBytes, 4U),
+            piPowersOf10[k]);
+        if (k <= 8U) {
+            Check("SegmentedSieveRange<" + wheel + ">(0, " + x + " + 1).size()",
+                SegmentedSieveRange<uint64_t, W>(0U, n + 1U, segmentBytes, 4U).size(), piPowersOf10[k]);
+        }
+    }
+    // A window far from 0, against the difference of two counts by LMO
+    Check("SegmentedCountRange<" + wheel + ">(10^12 + 1, 10^12 + 10^8 + 1)",
+        SegmentedCountRange<uint64_t, W>(1000000000001ULL, 1000100000001ULL, 0U, 4U),
+        CountPrimesLMO(1000100000000ULL) - CountPrimesLMO(1000000000000ULL));
+}
+
+// Within 2^32 of 2^64, a native first multiple would wrap, unless
+// computed with care, so the word engine must agree with BigInteger.
+template <typename W> void CheckNearWordEnd(const std::string& wheel, const uint64_t& lo, const uint64_t& hi, const bool& isBigChecked)
+{
+    const BigInteger top = BigInteger(1U) << 64U;
+    const std::string x = "[2^64 - " + boost::lexical_cast<std::string>(top - lo) + ", 2^64 - " +
+        boost::lexical_cast<std::string>(top - hi) + ")";
+    const uint64_t count = SegmentedCountRange<uint64_t, W>(lo, hi, 0U, 4U);
+    Check("SegmentedSieveRange<" + wheel + ">" + x + ".size()", SegmentedSieveRange<uint64_t, W>(lo, hi, 0U, 4U).size(), count);
+    if (isBigChecked) {
+        Check("SegmentedCountRange<" + wheel + ">" + x, count, SegmentedCountRange<BigInteger, W>(lo, hi, 0U, 1U));
+    }
+}
+
+int main()
+{
+    CheckSieves<Wheel30>("Wheel30");
+    CheckSieves<Wheel210>("Wheel210");
+
+    uint64_t n = 1U;
+    for (size_t k = 1U; k <= 12U; ++k) {
+        n *= 10U;
+        Check("CountPrimesLMO(10^" + std::to_string(k) + ")", CountPrimesLMO(n), piPowersOf10[k]);
+    }
+
+    const uint64_t max = ~(uint64_t)0U;
+    Check("SegmentedCountRange<Wheel30>[2^64 - 3000001, 2^64 - 1000001)",
+        SegmentedCountRange<uint64_t, Wheel30>(max - 3000000U, max - 1000000U, 0U, 4U), 44967U);
+    CheckNearWordEnd<Wheel30>("Wheel30", max - (1ULL << 31U) + 1U, max - (1ULL << 31U) + 200001U, true);
+    CheckNearWordEnd<Wheel30>("Wheel30", max - 100000U, max, true);
+    CheckNearWordEnd<Wheel210>("Wheel210", max - 3000000U, max - 1000000U, false);
+    CheckNearWordEnd<Wheel210>("Wheel210", max - 100000U, max, false);
+
+    return failures;
+}
@@ -0,0 +1,48 @@
+import sys
+from Eratosthenes import count, count_range, segmented_count, sieve_range
+
+# Regression checks of the public API against known values of pi(x), (as
+# check.cpp does for the engines,) exiting with the count of failures.
+# The windows near 2^64 sieve every base prime up to 2^32, and take a
+# minute or more.
+
+failures = 0
+
+
+def check(name, got, expected):
+    global failures
+    if got == expected:
+        print("ok  ", name, got)
+    else:
+        print("FAIL", name, got, "(expected", str(expected) + ")")
+        failures += 1
+
+
+# pi(10^k), for k from 0
+pi_powers_of_10 = [0, 4, 25, 168, 1229, 9592, 78498, 664579, 5761455, 50847534, 455052511, 4118054813, 37607912018]
+
+for k in range(1, 13):
+    n = 10**k
+    # (Past 10^7, these count by LMO, rather than sieving.)
+    check("count(10^%d)" % k, count(n), pi_powers_of_10[k])
+    check("segmented_count(10^%d)" % k, segmented_count(n), pi_powers_of_10[k])
+    for wheel in (30, 210):
+        if k <= 10:
+            check("count_range(0, 10^%d + 1, wheel=%d)" % (k, wheel), count_range(0, n + 1, wheel=wheel), pi_powers_of_10[k])
+        if k <= 8:
+            check("len(sieve_range(0, 10^%d + 1, wheel=%d))" % (k, wheel), len(sieve_range(0, n + 1, wheel=wheel)),
+                  pi_powers_of_10[k])
+
+# A window far from 0, against the difference of two counts
+check("count_range(10^12 + 1, 10^12 + 10^8 + 1)", count_range(10**12 + 1, 10**12 + 10**8 + 1),
+      count(10**12 + 10**8) - count(10**12))
+
+# Just below 2^64, by the uint64 engines, and up to 2^64 itself, by BigInteger
+top = 2**64
+for wheel in (30, 210):
+    check("count_range(2^64 - 3000001, 2^64 - 1000001, wheel=%d)" % wheel,
+          count_range(top - 3000001, top - 1000001, wheel=wheel), 44967)
+    check("len(sieve_range(2^64 - 100001, 2^64 - 1, wheel=%d))" % wheel,
+          len(sieve_range(top - 100001, top - 1, wheel=wheel)), count_range(top - 100001, top, wheel=wheel))
+
+sys.exit(failures)
@@ -2,9 +2,34 @@ import os
 import setuptools
 from distutils.core import setup, Extension
 
-cpp_args = ['-std=c++17', '-O3']
+cpp_args = ['-std=c++17', '-O3', '-pthread']
+link_args = ['-pthread']
+ROOT_PATH = os.path.abspath(os.path.dirname(__file__))
 
-README_PATH = os.path.join(os.path.abspath(os.path.dirname(__file__)), 'README.md')
+def is_set(name):
+    return os.environ.get(name, '0') not in ('', '0')
+
+# ERATOSTHENES_STATS=1 compiles in the counters behind last_run_stats().
+if is_set('ERATOSTHENES_STATS'):
+    cpp_args.append('-DQIMCIFA_STATS')
+
+# ERATOSTHENES_LTO=1 optimizes across the link, as well.
+if is_set('ERATOSTHENES_LTO'):
+    cpp_args.append('-flto')
+    link_args.append('-flto')
+
+# ERATOSTHENES_PGO=generate builds for "python bench.py --train" to write a
+# profile, (with GCC,) into ERATOSTHENES_PGO_DIR, and then ERATOSTHENES_PGO=use
+# rebuilds from that profile, (in the same source tree, from a clean build).
+PGO_DIR = os.path.abspath(os.environ.get('ERATOSTHENES_PGO_DIR', os.path.join(ROOT_PATH, 'pgo')))
+if os.environ.get('ERATOSTHENES_PGO') == 'generate':
+    cpp_args += ['-fprofile-generate', '-fprofile-update=atomic', '-fprofile-dir=' + PGO_DIR]
+    link_args += ['-fprofile-generate']
+elif os.environ.get('ERATOSTHENES_PGO') == 'use':
+    cpp_args += ['-fprofile-use', '-fprofile-correction', '-Wno-missing-profile', '-fprofile-dir=' + PGO_DIR]
+    link_args += ['-fprofile-use']
+
+README_PATH = os.path.join(ROOT_PATH, 'README.md')
 with open(README_PATH) as readme_file:
     README = readme_file.read()
 
@@ -12,9 +37,10 @@ ext_modules = [
     Extension(
         '_eratosthenes',
         ['Eratosthenes/_eratosthenes.cpp'],
-        include_dirs=['pybind11/include'],
+        include_dirs=['pybind11/include', 'Eratosthenes/include'],
         language='c++',
         extra_compile_args = cpp_args,
+        extra_link_args = link_args,
     ),
 ]
 
@@ -40,6 +66,7 @@ setup(
         "Topic :: Scientific/Engineering",
     ],
     install_requires=["pybind11"],
+    extras_require={"numpy": ["numpy"]},
     ext_modules=ext_modules,
     packages=['Eratosthenes'],
 )